@@ -7,7 +7,7 @@
 #include "logger.h"
 #include "zcl.h"
 
-Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_receiveTimer(new QTimer(this)), m_resetTimer(new QTimer(this)), m_permitJoinTimer(new QTimer(this)), m_serial(new QSerialPort(this)), m_socket(new QTcpSocket(this)), m_serialError(false), m_connected(false), m_permitJoin(false)
+Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_resetTimer(new QTimer(this)), m_permitJoinTimer(new QTimer(this)), m_serial(new QSerialPort(this)), m_socket(new QTcpSocket(this)), m_serialError(false), m_connected(false), m_permitJoin(false), m_busy(false)
 {
     QString portName = config->value("zigbee/port", "/dev/ttyUSB0").toString();
 
@@ -112,12 +112,10 @@ Adapter::Adapter(QSettings *config, QObject *parent) : QObject(parent), m_receiv
     m_multicast.append(IKEA_GROUP);
     m_multicast.append(GREEN_POWER_GROUP);
 
-    connect(m_device, &QIODevice::readyRead, this, &Adapter::startTimer);
-    connect(m_receiveTimer, &QTimer::timeout, this, &Adapter::readyRead);
+    connect(m_device, &QIODevice::readyRead, this, &Adapter::readyRead);
     connect(m_resetTimer, &QTimer::timeout, this, &Adapter::resetTimeout);
     connect(m_permitJoinTimer, &QTimer::timeout, this, &Adapter::permitJoinTimeout);
 
-    m_receiveTimer->setSingleShot(true);
     m_resetTimer->setSingleShot(true);
 }
 
@@ -155,6 +153,16 @@ void Adapter::init(void)
     }
 }
 
+void Adapter::enqueueCall(const std::function <void (void)> &call)
+{
+    QMetaObject::invokeMethod(this, [this, call] () { m_calls.enqueue(call); handleCalls(); });
+}
+
+void Adapter::clearCalls(void)
+{
+    QMetaObject::invokeMethod(this, [this] () { m_calls.clear(); });
+}
+
 bool Adapter::waitForSignal(const QObject *sender, const char *signal, int tiomeout)
 {
     QEventLoop loop;
@@ -240,6 +248,7 @@ void Adapter::reset(void)
     QList <QString> list = {"gpio", "flow"};
 
     m_device->readAll();
+    m_buffer.clear();
     m_resetTimer->start(RESET_TIMEOUT);
 
     logInfo << "Resetting adapter" << QString("(%1)").arg(list.contains(m_reset) ? m_reset : "soft").toUtf8().constData();
@@ -267,6 +276,19 @@ void Adapter::reset(void)
     }
 }
 
+void Adapter::handleCalls(void)
+{
+    if (m_busy)
+        return;
+
+    m_busy = true;
+
+    while (!m_calls.isEmpty())
+        m_calls.dequeue()();
+
+    m_busy = false;
+}
+
 void Adapter::sendData(const QByteArray &buffer)
 {
     logDebug(m_portDebug) << "Serial data sent:" << buffer.toHex(':');
@@ -310,17 +332,20 @@ void Adapter::socketConnected(void)
     reset();
 }
 
-void Adapter::startTimer(void)
-{
-    m_receiveTimer->start(RECEIVE_TIMEOUT);
-}
-
 void Adapter::readyRead(void)
 {
     QByteArray buffer = m_device->readAll();
 
     logDebug(m_portDebug)  << "Serial data received:" << buffer.toHex(':');
-    parseData(buffer);
+
+    m_buffer.append(buffer);
+    m_buffer.remove(0, parseData(m_buffer));
+
+    if (m_buffer.length() > RECEIVE_BUFFER_LIMIT)
+    {
+        logWarning << "Receive buffer overflow," << m_buffer.length() << "unparsed bytes dropped";
+        m_buffer.clear();
+    }
 
     QTimer::singleShot(0, this, &Adapter::handleQueue);
 }
@@ -335,9 +360,14 @@ void Adapter::resetTimeout(void)
 
 void Adapter::permitJoinTimeout(void)
 {
-    if (permitJoin(true))
-        return;
+    m_calls.enqueue([this] ()
+    {
+        if (permitJoin(true))
+            return;
+
+        m_permitJoinTimer->stop();
+        emit permitJoinUpdated(false);
+    });
 
-    m_permitJoinTimer->stop();
-    emit permitJoinUpdated(false);
+    handleCalls();
 }
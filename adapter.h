@@ -1,13 +1,12 @@
 #ifndef ADAPTER_H
 #define ADAPTER_H
 
-#define RECEIVE_TIMEOUT                 20
-
 #define PERMIT_JOIN_TIMEOUT             60000
 #define PERMIT_JOIN_BROARCAST_ADDRESS   0xFFFC
 
 #define RESET_TIMEOUT                   15000
 #define RESET_DELAY                     100
+#define RECEIVE_BUFFER_LIMIT            4096
 
 #define DEFAULT_GROUP                   0x0000
 #define IKEA_GROUP                      0x0385
@@ -37,6 +36,7 @@
 #define ADDRESS_MODE_64_BIT             0x03
 #define ADDRESS_MODE_BROADCAST          0xFF
 
+#include <functional>
 #include <QHostAddress>
 #include <QQueue>
 #include <QSerialPort>
@@ -178,6 +178,8 @@ public:
     inline void setRequestParameters(const QByteArray &value, bool extendedTimeout = true) { m_requestAddress = value; m_extendedTimeout = extendedTimeout; }
 
     void init(void);
+    void enqueueCall(const std::function <void (void)> &call);
+    void clearCalls(void);
     bool waitForSignal(const QObject *sender, const char *signal, int tiomeout);
 
     void setPermitJoin(bool enabled);
@@ -190,7 +192,7 @@ public:
 
 protected:
 
-    QTimer *m_receiveTimer, *m_resetTimer, *m_permitJoinTimer;
+    QTimer *m_resetTimer, *m_permitJoinTimer;
 
     QSerialPort *m_serial;
     QTcpSocket *m_socket;
@@ -218,6 +220,8 @@ protected:
 
     QMap <quint8, EndpointData> m_endpoints;
     QList <quint16> m_multicast;
+
+    QByteArray m_buffer;
     QQueue <QByteArray> m_queue;
 
     void reset(void);
@@ -225,8 +229,13 @@ protected:
 
 private:
 
+    QQueue <std::function <void (void)>> m_calls;
+    bool m_busy;
+
+    void handleCalls(void);
+
     virtual void softReset(void) = 0;
-    virtual void parseData(QByteArray &buffer) = 0;
+    virtual int parseData(const QByteArray &buffer) = 0;
     virtual bool permitJoin(bool enabled) = 0;
 
 protected slots:
@@ -239,7 +248,6 @@ private slots:
     void socketError(QTcpSocket::SocketError error);
     void socketConnected(void);
 
-    void startTimer(void);
     void readyRead(void);
     void resetTimeout(void);
     void permitJoinTimeout(void);
@@ -247,10 +255,11 @@ private slots:
 signals:
 
     void adapterReset(void);
-    void coordinatorReady(void);
+    void coordinatorReady(const QByteArray &ieeeAddress, const QString &manufacturerName, const QString &modelName, const QString &firmware);
 
     void permitJoinUpdated(bool enabled);
     void requestFinished(quint8 id, quint8 status);
+    void zdoRequestFailed(quint8 id, quint8 status);
 
     void deviceJoined(const QByteArray &ieeeAddress, quint16 networkAddress);
     void deviceLeft(const QByteArray &ieeeAddress);
@@ -0,0 +1,22 @@
+include(../../homed-common/homed-gpio.pri)
+
+QT += network serialport
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = homed-zigbee-bench
+INCLUDEPATH += .. ../../homed-common
+
+HEADERS += \
+    ../adapter.h \
+    ../ezsp.h \
+    ../zboss.h
+
+SOURCES += \
+    ../adapter.cpp \
+    ../ezsp.cpp \
+    ../zboss.cpp \
+    ../zcl.cpp \
+    main.cpp
@@ -0,0 +1,156 @@
+#include <QtEndian>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include "ezsp.h"
+#include "logger.h"
+#include "zboss.h"
+
+#define BENCH_BUFFERS                   1000
+#define BENCH_ITERATIONS                200
+
+static quint16 ccittTable[256], crc16Table[256];
+
+static void buildTables(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        quint16 msb = static_cast <quint16> (i << 8), lsb = static_cast <quint16> (i);
+
+        for (int j = 0; j < 8; j++)
+        {
+            msb = msb & 0x8000 ? static_cast <quint16> (msb << 1) ^ 0x1021 : static_cast <quint16> (msb << 1);
+            lsb = lsb & 0x0001 ? (lsb >> 1) ^ 0x8408 : lsb >> 1;
+        }
+
+        ccittTable[i] = msb;
+        crc16Table[i] = lsb;
+    }
+}
+
+static quint16 ccittSerial(const quint8 *data, quint32 length)
+{
+    quint16 crc = 0xFFFF;
+
+    while (length--)
+        crc = static_cast <quint16> (crc << 8) ^ ccittTable[(crc >> 8) ^ *data++];
+
+    return qToBigEndian(crc);
+}
+
+static quint16 crc16Serial(const quint8 *data, quint32 length)
+{
+    quint16 crc = 0x0000;
+
+    while (length--)
+        crc = static_cast <quint16> (crc >> 8) ^ crc16Table[(crc ^ *data++) & 0xFF];
+
+    return qToLittleEndian(crc);
+}
+
+static QByteArray stuffSwitch(const QByteArray &request)
+{
+    QByteArray buffer;
+
+    for (int i = 0; i < request.length(); i++)
+    {
+        switch (request.at(i))
+        {
+            case 0x11: buffer.append(0x7D).append(0x31); break;
+            case 0x13: buffer.append(0x7D).append(0x33); break;
+            case 0x18: buffer.append(0x7D).append(0x38); break;
+            case 0x1A: buffer.append(0x7D).append(0x3A); break;
+            case 0x7D: buffer.append(0x7D).append(0x5D); break;
+            case 0x7E: buffer.append(0x7D).append(0x5E); break;
+            default:   buffer.append(request.at(i)); break;
+        }
+    }
+
+    return buffer.append(static_cast <char> (ASH_PACKET_FLAG));
+}
+
+static void randomizeShift(QByteArray &payload)
+{
+    quint8 *buffer = reinterpret_cast <quint8*> (payload.data()), byte = 0x42;
+
+    for (int i = 0; i < payload.length(); i++)
+    {
+        buffer[i] ^= byte;
+        byte = byte & 0x01 ? (byte >> 1) ^ 0xB8 : byte >> 1;
+    }
+}
+
+template <typename T> static double measure(QList <QByteArray> &list, T function)
+{
+    QElapsedTimer timer;
+    quint32 sink = 0;
+
+    timer.start();
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++)
+        for (int j = 0; j < list.count(); j++)
+            sink += function(list[j]);
+
+    if (sink == 0xFFFFFFFF)
+        logInfo << "Unexpected checksum";
+
+    return static_cast <double> (timer.nsecsElapsed()) / BENCH_ITERATIONS / list.count();
+}
+
+static QString result(const char *name, double before, double after)
+{
+    return QString::asprintf("%s %.1f -> %.1f ns (%.1fx)", name, before, after, before / after);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QByteArray check("123456789");
+
+    buildTables();
+
+    if (qFromBigEndian(EZSP::getCRC(reinterpret_cast <const quint8*> (check.constData()), check.length())) != 0x29B1)
+    {
+        logWarning << "CRC-CCITT check value mismatch";
+        return 1;
+    }
+
+    for (int size : {16, 64, 256})
+    {
+        QList <QByteArray> list;
+        double ccitt[2], crc16[2], stuffing[2], randomize[2];
+
+        for (int i = 0; i < BENCH_BUFFERS; i++)
+        {
+            QByteArray buffer(size, 0x00), a, b;
+
+            QRandomGenerator::global()->fillRange(reinterpret_cast <quint32*> (buffer.data()), size / 4);
+            a = buffer;
+            b = buffer;
+
+            randomizeShift(a);
+            EZSP::randomize(b);
+
+            if (ccittSerial(reinterpret_cast <const quint8*> (buffer.constData()), size) != EZSP::getCRC(reinterpret_cast <const quint8*> (buffer.constData()), size) || crc16Serial(reinterpret_cast <const quint8*> (buffer.constData()), size) != ZBoss::getCRC16(reinterpret_cast <const quint8*> (buffer.constData()), size) || stuffSwitch(buffer) != EZSP::stuffData(buffer) || a != b)
+            {
+                logWarning << "Kernel output mismatch for buffer" << buffer.toHex(':');
+                return 1;
+            }
+
+            list.append(buffer);
+        }
+
+        ccitt[0] = measure(list, [] (QByteArray &buffer) { return ccittSerial(reinterpret_cast <const quint8*> (buffer.constData()), buffer.length()); });
+        ccitt[1] = measure(list, [] (QByteArray &buffer) { return EZSP::getCRC(reinterpret_cast <const quint8*> (buffer.constData()), buffer.length()); });
+        crc16[0] = measure(list, [] (QByteArray &buffer) { return crc16Serial(reinterpret_cast <const quint8*> (buffer.constData()), buffer.length()); });
+        crc16[1] = measure(list, [] (QByteArray &buffer) { return ZBoss::getCRC16(reinterpret_cast <const quint8*> (buffer.constData()), buffer.length()); });
+        stuffing[0] = measure(list, [] (QByteArray &buffer) { return stuffSwitch(buffer).length(); });
+        stuffing[1] = measure(list, [] (QByteArray &buffer) { return EZSP::stuffData(buffer).length(); });
+        randomize[0] = measure(list, [] (QByteArray &buffer) { randomizeShift(buffer); return static_cast <quint8> (buffer.at(0)); });
+        randomize[1] = measure(list, [] (QByteArray &buffer) { EZSP::randomize(buffer); return static_cast <quint8> (buffer.at(0)); });
+
+        logInfo << QString::asprintf("%3d bytes:", size).toUtf8().constData() << result("EZSP CRC", ccitt[0], ccitt[1]).toUtf8().constData() << result("ZBoss CRC16", crc16[0], crc16[1]).toUtf8().constData() << result("ASH stuffing", stuffing[0], stuffing[1]).toUtf8().constData() << result("ASH randomize", randomize[0], randomize[1]).toUtf8().constData();
+    }
+
+    return 0;
+}
@@ -196,7 +196,7 @@ void Controller::updateDeviceData(void)
     for (auto it = m_zigbee->devices()->begin(); it != m_zigbee->devices()->end(); it++)
     {
         Availability check = it.value()->availability();
-        qint64 timeout = it.value()->options().value("availability").toInt();
+        qint64 timeout = it.value()->settings().availability;
 
         if (it.value()->removed() || it.value()->logicalType() == LogicalType::Coordinator)
             continue;
@@ -206,7 +206,7 @@ void Controller::updateDeviceData(void)
 
         it.value()->setAvailability(it.value()->active() ? time - it.value()->lastSeen() <= timeout ? Availability::Online : Availability::Offline : Availability::Inactive);
 
-        if (it.value()->availability() == check && m_lastSeen.value(it.value()->ieeeAddress()) == it.value()->lastSeen())
+        if (it.value()->availability() == check && m_lastSeen.value(it.value()->ieeeAddress()) == it.value()->lastSeen() && m_throttled.value(it.value()->ieeeAddress()) == it.value()->throttled())
             continue;
 
         json = {{"lastSeen", it.value()->lastSeen()}, {"status", it.value()->availability() == Availability::Online ? "online" : "offline"}};
@@ -214,8 +214,12 @@ void Controller::updateDeviceData(void)
         if (it.value()->ota().running())
             json.insert("otaProgress", round(it.value()->ota().progress()));
 
+        if (it.value()->throttled())
+            json.insert("throttled", static_cast <qint64> (it.value()->throttled()));
+
         mqttPublish(mqttTopic("device/%1/%2").arg(serviceTopic(), m_zigbee->devices()->names() ? it.value()->name() : it.value()->ieeeAddress().toHex(':')), json, true);
         m_lastSeen.insert(it.value()->ieeeAddress(), it.value()->lastSeen());
+        m_throttled.insert(it.value()->ieeeAddress(), it.value()->throttled());
     }
 }
 
@@ -278,7 +282,7 @@ void Controller::deviceEvent(DeviceObject *device, ZigBee::Event event, const QJ
 void Controller::endpointUpdated(DeviceObject *device, quint8 endpointId)
 {
     QMap <QString, QVariant> endpointMap, deviceMap = {{"linkQuality", device->linkQuality()}};
-    bool retain = device->options().value("retain").toBool();
+    bool retain = device->settings().retain;
 
     for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
     {
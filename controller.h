@@ -51,6 +51,7 @@ private:
     bool m_haEnabled, m_networkStarted;
 
     QMap <QByteArray, qint64> m_lastSeen;
+    QMap <QByteArray, quint32> m_throttled;
 
     void publishExposes(DeviceObject *device, bool remove = false);
     void serviceOnline(void);
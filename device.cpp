@@ -1,5 +1,6 @@
 #include <QtEndian>
 #include <QFile>
+#include <QFileInfo>
 #include "actions/common.h"
 #include "actions/other.h"
 #include "properties/common.h"
@@ -130,20 +131,35 @@ void DeviceList::storeProperties(void)
 
 Device DeviceList::byName(const QString &name)
 {
-    for (auto it = begin(); it != end(); it++)
-        if (it.value()->name() == name)
-            return it.value();
+    auto it = m_nameIndex.find(name);
+
+    if (it != m_nameIndex.end())
+        return it.value();
 
     return value(QByteArray::fromHex(name.toUtf8()));
 }
 
 Device DeviceList::byNetwork(quint16 networkAddress)
 {
-    for (auto it = begin(); it != end(); it++)
-        if (it.value()->networkAddress() == networkAddress)
-            return it.value();
+    return m_networkIndex.value(networkAddress);
+}
+
+void DeviceList::indexDevice(const Device &device)
+{
+    m_networkIndex.insert(device->networkAddress(), device);
+    m_nameIndex.insert(device->name(), device);
+}
+
+void DeviceList::unindexDevice(const Device &device)
+{
+    auto network = m_networkIndex.find(device->networkAddress());
+    auto name = m_nameIndex.find(device->name());
+
+    if (network != m_networkIndex.end() && network.value() == device)
+        m_networkIndex.erase(network);
 
-    return Device();
+    if (name != m_nameIndex.end() && name.value() == device)
+        m_nameIndex.erase(name);
 }
 
 Endpoint DeviceList::endpoint(const Device &device, quint8 endpointId)
@@ -228,25 +244,21 @@ void DeviceList::setupDevice(const Device &device)
 {
     QMap <QString, QVariant> userOptions;
     QList <QDir> list = {m_externalDir, m_libraryDir};
-    QString manufacturerName, modelName;
+    QString ieeeAddress = device->ieeeAddress().toHex(':'), manufacturerName, modelName;
+    QJsonObject options;
 
     if (device->logicalType() == LogicalType::Coordinator)
         return;
 
-    if (m_optionsFile.open(QFile::ReadOnly))
-    {
-        QString ieeeAddress = device->ieeeAddress().toHex(':');
-        QJsonObject json = QJsonDocument::fromJson(m_optionsFile.readAll()).object(), options = json.value(json.contains(ieeeAddress) ? ieeeAddress : device->name()).toObject();
+    options = readOptions();
+    options = options.value(options.contains(ieeeAddress) ? ieeeAddress : device->name()).toObject();
 
-        for (auto it = options.begin(); it != options.end(); it++)
-        {
-            if (it.key().endsWith("Divider") && !it.value().toDouble())
-                continue;
-
-            userOptions.insert(it.key(), it.value().toVariant());
-        }
+    for (auto it = options.begin(); it != options.end(); it++)
+    {
+        if (it.key().endsWith("Divider") && !it.value().toDouble())
+            continue;
 
-        m_optionsFile.close();
+        userOptions.insert(it.key(), it.value().toVariant());
     }
 
     device->setSupported(false);
@@ -269,6 +281,7 @@ void DeviceList::setupDevice(const Device &device)
 
         it.value()->timer()->stop();
         it.value()->properties().clear();
+        it.value()->clusterProperties().clear();
         it.value()->actions().clear();
         it.value()->reportings().clear();
         it.value()->polls().clear();
@@ -284,37 +297,7 @@ void DeviceList::setupDevice(const Device &device)
 
         for (int i = 0; i < list.count() && !device->supported(); i++)
         {
-            QFile file(QString("%1/%2").arg(it->path(), list.at(i)));
-            QJsonObject json;
-            QJsonArray array;
-
-            if (!file.open(QFile::ReadOnly))
-            {
-                if (!m_brokenFiles.contains(file.fileName()))
-                {
-                    logWarning << "Unable to open library file" << file.fileName();
-                    m_brokenFiles.append(file.fileName());
-                }
-
-                continue;
-            }
-
-            json = QJsonDocument::fromJson(file.readAll()).object();
-            file.close();
-
-            if (json.isEmpty())
-            {
-                if (!m_brokenFiles.contains(file.fileName()))
-                {
-                    logWarning << "Library file" << file.fileName() << "JSON data is empty or not valid";
-                    m_brokenFiles.append(file.fileName());
-                }
-
-                continue;
-            }
-
-            array = json.value(manufacturerName).toArray();
-            m_brokenFiles.removeAll(file.fileName());
+            QJsonArray array = readLibrary(QString("%1/%2").arg(it->path(), list.at(i))).value(manufacturerName).toArray();
 
             if (array.isEmpty())
                 continue;
@@ -371,6 +354,33 @@ void DeviceList::setupDevice(const Device &device)
         device->setDescription(QString("%1/%2").arg(device->manufacturerName(), device->modelName()));
         recognizeDevice(device);
     }
+
+    device->settings().checkTransactionId = device->options().value("checkTransactionId").toBool();
+    device->settings().skipAttributeRead = device->options().value("skipAttributeRead").toBool();
+    device->settings().tuyaDataQuery = device->options().value("tuyaDataQuery").toBool();
+    device->settings().utcTime = device->options().value("utcTime").toBool();
+    device->settings().retain = device->options().value("retain").toBool();
+    device->settings().availability = device->options().value("availability").toInt();
+
+    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+    {
+        for (int i = 0; i < it.value()->properties().count(); i++)
+        {
+            const Property &property = it.value()->properties().at(i);
+
+            property->setupOptions();
+
+            for (int j = 0; j < property->clusters().count(); j++)
+            {
+                QList <Property> &list = it.value()->clusterProperties()[property->clusters().at(j)];
+
+                if (list.contains(property))
+                    continue;
+
+                list.append(property);
+            }
+        }
+    }
 }
 
 void DeviceList::setupEndpoint(const Endpoint &endpoint, const QJsonObject &json, bool multiple)
@@ -560,6 +570,65 @@ void DeviceList::setupEndpoint(const Endpoint &endpoint, const QJsonObject &json
     endpoint->timer()->start(1000);
 }
 
+QJsonObject DeviceList::readLibrary(const QString &fileName)
+{
+    QDateTime time = QFileInfo(fileName).lastModified();
+    auto it = m_library.find(fileName);
+    QFile file(fileName);
+    QJsonObject json;
+
+    if (it != m_library.end() && it.value().first == time)
+        return it.value().second;
+
+    if (!file.open(QFile::ReadOnly))
+    {
+        if (!m_brokenFiles.contains(fileName))
+        {
+            logWarning << "Unable to open library file" << fileName;
+            m_brokenFiles.append(fileName);
+        }
+
+        m_library.remove(fileName);
+        return json;
+    }
+
+    json = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    if (json.isEmpty())
+    {
+        if (!m_brokenFiles.contains(fileName))
+        {
+            logWarning << "Library file" << fileName << "JSON data is empty or not valid";
+            m_brokenFiles.append(fileName);
+        }
+    }
+    else
+        m_brokenFiles.removeAll(fileName);
+
+    m_library.insert(fileName, qMakePair(time, json));
+    return json;
+}
+
+QJsonObject DeviceList::readOptions(void)
+{
+    QDateTime time = QFileInfo(m_optionsFile).lastModified();
+
+    if (time == m_optionsTime)
+        return m_options;
+
+    m_options = QJsonObject();
+    m_optionsTime = time;
+
+    if (!m_optionsFile.open(QFile::ReadOnly))
+        return m_options;
+
+    m_options = QJsonDocument::fromJson(m_optionsFile.readAll()).object();
+    m_optionsFile.close();
+
+    return m_options;
+}
+
 void DeviceList::recognizeDevice(const Device &device)
 {
     for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
@@ -925,6 +994,7 @@ void DeviceList::removeDevice(const Device &device)
         return;
     }
 
+    unindexDevice(device);
     remove(device->ieeeAddress());
 }
 
@@ -1038,6 +1108,7 @@ void DeviceList::unserializeDevices(const QJsonArray &devices)
             }
 
             insert(device->ieeeAddress(), device);
+            indexDevice(device);
         }
     }
 
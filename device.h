@@ -31,7 +31,8 @@ enum class InterviewStatus
     FirmwareVersion,
     ColorCapabilities,
     ZoneEnroll,
-    Finished
+    Finished,
+    Fingerprint
 };
 
 enum class DescriptorStatus
@@ -49,6 +50,16 @@ enum class ZoneStatus
     Enrolled
 };
 
+struct DeviceSettings
+{
+    bool checkTransactionId;
+    bool skipAttributeRead;
+    bool tuyaDataQuery;
+    bool utcTime;
+    bool retain;
+    qint64 availability;
+};
+
 class OTA
 {
 
@@ -132,6 +143,7 @@ public:
     inline void setUpdated(bool value) { m_updated = value; }
 
     inline QList <Property> &properties(void) { return m_properties; }
+    inline QHash <quint16, QList <Property>> &clusterProperties(void) { return m_clusterProperties; }
     inline QList <Action> &actions(void) { return m_actions; }
     inline QList <Binding> &bindings(void) { return m_bindings; }
     inline QList <Reporting> &reportings(void) { return m_reportings; }
@@ -153,6 +165,7 @@ private:
     bool m_updated;
 
     QList <Property> m_properties;
+    QHash <quint16, QList <Property>> m_clusterProperties;
     QList <Action> m_actions;
     QList <Binding> m_bindings;
     QList <Reporting> m_reportings;
@@ -167,7 +180,7 @@ class DeviceObject : public AbstractDeviceObject
 public:
 
     DeviceObject(const QByteArray &ieeeAddress, quint16 networkAddress, const QString name = QString(), bool removed = false) :
-        AbstractDeviceObject(name.isEmpty() ? ieeeAddress.toHex(':') : name), m_timer(new QTimer(this)), m_ieeeAddress(ieeeAddress), m_networkAddress(networkAddress), m_removed(removed), m_supported(false), m_interviewStatus(InterviewStatus::NodeDescriptor), m_logicalType(LogicalType::EndDevice), m_manufacturerCode(0), m_powerSource(POWER_SOURCE_UNKNOWN), m_joinTime(0), m_lastSeen(0), m_linkQuality(0), m_lqiRequestPending(false) {}
+        AbstractDeviceObject(name.isEmpty() ? ieeeAddress.toHex(':') : name), m_timer(new QTimer(this)), m_ieeeAddress(ieeeAddress), m_networkAddress(networkAddress), m_removed(removed), m_supported(false), m_interviewStatus(InterviewStatus::NodeDescriptor), m_logicalType(LogicalType::EndDevice), m_manufacturerCode(0), m_powerSource(POWER_SOURCE_UNKNOWN), m_joinTime(0), m_lastSeen(0), m_linkQuality(0), m_lqiRequestPending(false), m_transactionId(0), m_requestFailures(0), m_tokens(0), m_tokenTime(0), m_throttled(0), m_awakeTime(0), m_settings() {}
 
     inline QTimer *timer(void) { return m_timer; }
     inline QByteArray ieeeAddress(void) { return m_ieeeAddress; }
@@ -184,9 +197,6 @@ public:
     inline InterviewStatus interviewStatus(void) { return m_interviewStatus; }
     inline void setInterviewStatus(InterviewStatus value) { m_interviewStatus = value; }
 
-    inline quint8 interviewEndpointId(void) { return m_interviewEndpointId; }
-    inline void setInterviewEndpointId(quint8 value) { m_interviewEndpointId = value; }
-
     inline LogicalType logicalType(void) { return m_logicalType; }
     inline void setLogicalType(LogicalType value) { m_logicalType = value; }
 
@@ -216,6 +226,26 @@ public:
     inline bool lqiRequestPending(void) { return m_lqiRequestPending; }
     inline void setLqiRequestPending(bool value) { m_lqiRequestPending = value; }
 
+    inline quint8 nextTransactionId(void) { return m_transactionId++; }
+
+    inline int requestFailures(void) { return m_requestFailures; }
+    inline void setRequestFailures(int value) { m_requestFailures = value; }
+
+    inline double tokens(void) { return m_tokens; }
+    inline void setTokens(double value) { m_tokens = value; }
+
+    inline qint64 tokenTime(void) { return m_tokenTime; }
+    inline void setTokenTime(qint64 value) { m_tokenTime = value; }
+
+    inline quint32 throttled(void) { return m_throttled; }
+    inline void increaseThrottled(void) { m_throttled++; }
+
+    inline qint64 awakeTime(void) { return m_awakeTime; }
+    inline void setAwakeTime(qint64 value) { m_awakeTime = value; }
+    inline QList <quint32> &mailbox(void) { return m_mailbox; }
+
+    inline DeviceSettings &settings(void) { return m_settings; }
+
     inline OTA &ota(void) { return m_otaData; }
     inline QMap <quint16, quint8> &neighbors(void) { return m_neighbors; }
 
@@ -228,7 +258,6 @@ private:
     bool m_removed, m_supported;
 
     InterviewStatus m_interviewStatus;
-    quint8 m_interviewEndpointId;
 
     LogicalType m_logicalType;
     quint16 m_manufacturerCode;
@@ -240,6 +269,17 @@ private:
 
     quint8 m_lqiRequestIndex;
     bool m_lqiRequestPending;
+    quint8 m_transactionId;
+    int m_requestFailures;
+
+    double m_tokens;
+    qint64 m_tokenTime;
+    quint32 m_throttled;
+
+    qint64 m_awakeTime;
+    QList <quint32> m_mailbox;
+
+    DeviceSettings m_settings;
 
     OTA m_otaData;
     QMap <quint16, quint8> m_neighbors;
@@ -269,6 +309,8 @@ public:
 
     Device byName(const QString &name);
     Device byNetwork(quint16 networkAddress);
+    void indexDevice(const Device &device);
+    void unindexDevice(const Device &device);
     Endpoint endpoint(const Device &device, quint8 endpointId);
 
     void identityHandler(const Device &device, QString &manufacturerName, QString &modelName);
@@ -290,9 +332,19 @@ private:
     QDir m_otaDir, m_externalDir, m_libraryDir;
     bool m_names, m_permitJoin;
 
+    QHash <quint16, Device> m_networkIndex;
+    QHash <QString, Device> m_nameIndex;
+
+    QMap <QString, QPair <QDateTime, QJsonObject>> m_library;
+    QJsonObject m_options;
+    QDateTime m_optionsTime;
+
     QMap <QString, QVariant> m_exposeOptions;
     QList <QString> m_specialExposes, m_brokenFiles;
 
+    QJsonObject readLibrary(const QString &fileName);
+    QJsonObject readOptions(void);
+
     void unserializeDevices(const QJsonArray &devices);
     void unserializeProperties(const QJsonObject &properties);
 
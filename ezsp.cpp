@@ -1,30 +1,127 @@
 #include <QtEndian>
+#include <QDateTime>
 #include <QRandomGenerator>
 #include "ezsp.h"
 #include "logger.h"
 #include "zcl.h"
 
-static const uint16_t crcTable[256] =
-{
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
-    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4, 0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823, 0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D, 0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A, 0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+static const uint16_t crcTable[4][256] =
+{
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+        0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+        0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+        0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4, 0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+        0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823, 0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+        0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+        0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+        0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+        0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+        0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+        0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D, 0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+        0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+        0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+        0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A, 0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+        0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+        0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+    },
+    {
+        0x0000, 0x3331, 0x6662, 0x5553, 0xCCC4, 0xFFF5, 0xAAA6, 0x9997, 0x89A9, 0xBA98, 0xEFCB, 0xDCFA, 0x456D, 0x765C, 0x230F, 0x103E,
+        0x0373, 0x3042, 0x6511, 0x5620, 0xCFB7, 0xFC86, 0xA9D5, 0x9AE4, 0x8ADA, 0xB9EB, 0xECB8, 0xDF89, 0x461E, 0x752F, 0x207C, 0x134D,
+        0x06E6, 0x35D7, 0x6084, 0x53B5, 0xCA22, 0xF913, 0xAC40, 0x9F71, 0x8F4F, 0xBC7E, 0xE92D, 0xDA1C, 0x438B, 0x70BA, 0x25E9, 0x16D8,
+        0x0595, 0x36A4, 0x63F7, 0x50C6, 0xC951, 0xFA60, 0xAF33, 0x9C02, 0x8C3C, 0xBF0D, 0xEA5E, 0xD96F, 0x40F8, 0x73C9, 0x269A, 0x15AB,
+        0x0DCC, 0x3EFD, 0x6BAE, 0x589F, 0xC108, 0xF239, 0xA76A, 0x945B, 0x8465, 0xB754, 0xE207, 0xD136, 0x48A1, 0x7B90, 0x2EC3, 0x1DF2,
+        0x0EBF, 0x3D8E, 0x68DD, 0x5BEC, 0xC27B, 0xF14A, 0xA419, 0x9728, 0x8716, 0xB427, 0xE174, 0xD245, 0x4BD2, 0x78E3, 0x2DB0, 0x1E81,
+        0x0B2A, 0x381B, 0x6D48, 0x5E79, 0xC7EE, 0xF4DF, 0xA18C, 0x92BD, 0x8283, 0xB1B2, 0xE4E1, 0xD7D0, 0x4E47, 0x7D76, 0x2825, 0x1B14,
+        0x0859, 0x3B68, 0x6E3B, 0x5D0A, 0xC49D, 0xF7AC, 0xA2FF, 0x91CE, 0x81F0, 0xB2C1, 0xE792, 0xD4A3, 0x4D34, 0x7E05, 0x2B56, 0x1867,
+        0x1B98, 0x28A9, 0x7DFA, 0x4ECB, 0xD75C, 0xE46D, 0xB13E, 0x820F, 0x9231, 0xA100, 0xF453, 0xC762, 0x5EF5, 0x6DC4, 0x3897, 0x0BA6,
+        0x18EB, 0x2BDA, 0x7E89, 0x4DB8, 0xD42F, 0xE71E, 0xB24D, 0x817C, 0x9142, 0xA273, 0xF720, 0xC411, 0x5D86, 0x6EB7, 0x3BE4, 0x08D5,
+        0x1D7E, 0x2E4F, 0x7B1C, 0x482D, 0xD1BA, 0xE28B, 0xB7D8, 0x84E9, 0x94D7, 0xA7E6, 0xF2B5, 0xC184, 0x5813, 0x6B22, 0x3E71, 0x0D40,
+        0x1E0D, 0x2D3C, 0x786F, 0x4B5E, 0xD2C9, 0xE1F8, 0xB4AB, 0x879A, 0x97A4, 0xA495, 0xF1C6, 0xC2F7, 0x5B60, 0x6851, 0x3D02, 0x0E33,
+        0x1654, 0x2565, 0x7036, 0x4307, 0xDA90, 0xE9A1, 0xBCF2, 0x8FC3, 0x9FFD, 0xACCC, 0xF99F, 0xCAAE, 0x5339, 0x6008, 0x355B, 0x066A,
+        0x1527, 0x2616, 0x7345, 0x4074, 0xD9E3, 0xEAD2, 0xBF81, 0x8CB0, 0x9C8E, 0xAFBF, 0xFAEC, 0xC9DD, 0x504A, 0x637B, 0x3628, 0x0519,
+        0x10B2, 0x2383, 0x76D0, 0x45E1, 0xDC76, 0xEF47, 0xBA14, 0x8925, 0x991B, 0xAA2A, 0xFF79, 0xCC48, 0x55DF, 0x66EE, 0x33BD, 0x008C,
+        0x13C1, 0x20F0, 0x75A3, 0x4692, 0xDF05, 0xEC34, 0xB967, 0x8A56, 0x9A68, 0xA959, 0xFC0A, 0xCF3B, 0x56AC, 0x659D, 0x30CE, 0x03FF
+    },
+    {
+        0x0000, 0x3730, 0x6E60, 0x5950, 0xDCC0, 0xEBF0, 0xB2A0, 0x8590, 0xA9A1, 0x9E91, 0xC7C1, 0xF0F1, 0x7561, 0x4251, 0x1B01, 0x2C31,
+        0x4363, 0x7453, 0x2D03, 0x1A33, 0x9FA3, 0xA893, 0xF1C3, 0xC6F3, 0xEAC2, 0xDDF2, 0x84A2, 0xB392, 0x3602, 0x0132, 0x5862, 0x6F52,
+        0x86C6, 0xB1F6, 0xE8A6, 0xDF96, 0x5A06, 0x6D36, 0x3466, 0x0356, 0x2F67, 0x1857, 0x4107, 0x7637, 0xF3A7, 0xC497, 0x9DC7, 0xAAF7,
+        0xC5A5, 0xF295, 0xABC5, 0x9CF5, 0x1965, 0x2E55, 0x7705, 0x4035, 0x6C04, 0x5B34, 0x0264, 0x3554, 0xB0C4, 0x87F4, 0xDEA4, 0xE994,
+        0x1DAD, 0x2A9D, 0x73CD, 0x44FD, 0xC16D, 0xF65D, 0xAF0D, 0x983D, 0xB40C, 0x833C, 0xDA6C, 0xED5C, 0x68CC, 0x5FFC, 0x06AC, 0x319C,
+        0x5ECE, 0x69FE, 0x30AE, 0x079E, 0x820E, 0xB53E, 0xEC6E, 0xDB5E, 0xF76F, 0xC05F, 0x990F, 0xAE3F, 0x2BAF, 0x1C9F, 0x45CF, 0x72FF,
+        0x9B6B, 0xAC5B, 0xF50B, 0xC23B, 0x47AB, 0x709B, 0x29CB, 0x1EFB, 0x32CA, 0x05FA, 0x5CAA, 0x6B9A, 0xEE0A, 0xD93A, 0x806A, 0xB75A,
+        0xD808, 0xEF38, 0xB668, 0x8158, 0x04C8, 0x33F8, 0x6AA8, 0x5D98, 0x71A9, 0x4699, 0x1FC9, 0x28F9, 0xAD69, 0x9A59, 0xC309, 0xF439,
+        0x3B5A, 0x0C6A, 0x553A, 0x620A, 0xE79A, 0xD0AA, 0x89FA, 0xBECA, 0x92FB, 0xA5CB, 0xFC9B, 0xCBAB, 0x4E3B, 0x790B, 0x205B, 0x176B,
+        0x7839, 0x4F09, 0x1659, 0x2169, 0xA4F9, 0x93C9, 0xCA99, 0xFDA9, 0xD198, 0xE6A8, 0xBFF8, 0x88C8, 0x0D58, 0x3A68, 0x6338, 0x5408,
+        0xBD9C, 0x8AAC, 0xD3FC, 0xE4CC, 0x615C, 0x566C, 0x0F3C, 0x380C, 0x143D, 0x230D, 0x7A5D, 0x4D6D, 0xC8FD, 0xFFCD, 0xA69D, 0x91AD,
+        0xFEFF, 0xC9CF, 0x909F, 0xA7AF, 0x223F, 0x150F, 0x4C5F, 0x7B6F, 0x575E, 0x606E, 0x393E, 0x0E0E, 0x8B9E, 0xBCAE, 0xE5FE, 0xD2CE,
+        0x26F7, 0x11C7, 0x4897, 0x7FA7, 0xFA37, 0xCD07, 0x9457, 0xA367, 0x8F56, 0xB866, 0xE136, 0xD606, 0x5396, 0x64A6, 0x3DF6, 0x0AC6,
+        0x6594, 0x52A4, 0x0BF4, 0x3CC4, 0xB954, 0x8E64, 0xD734, 0xE004, 0xCC35, 0xFB05, 0xA255, 0x9565, 0x10F5, 0x27C5, 0x7E95, 0x49A5,
+        0xA031, 0x9701, 0xCE51, 0xF961, 0x7CF1, 0x4BC1, 0x1291, 0x25A1, 0x0990, 0x3EA0, 0x67F0, 0x50C0, 0xD550, 0xE260, 0xBB30, 0x8C00,
+        0xE352, 0xD462, 0x8D32, 0xBA02, 0x3F92, 0x08A2, 0x51F2, 0x66C2, 0x4AF3, 0x7DC3, 0x2493, 0x13A3, 0x9633, 0xA103, 0xF853, 0xCF63
+    },
+    {
+        0x0000, 0x76B4, 0xED68, 0x9BDC, 0xCAF1, 0xBC45, 0x2799, 0x512D, 0x85C3, 0xF377, 0x68AB, 0x1E1F, 0x4F32, 0x3986, 0xA25A, 0xD4EE,
+        0x1BA7, 0x6D13, 0xF6CF, 0x807B, 0xD156, 0xA7E2, 0x3C3E, 0x4A8A, 0x9E64, 0xE8D0, 0x730C, 0x05B8, 0x5495, 0x2221, 0xB9FD, 0xCF49,
+        0x374E, 0x41FA, 0xDA26, 0xAC92, 0xFDBF, 0x8B0B, 0x10D7, 0x6663, 0xB28D, 0xC439, 0x5FE5, 0x2951, 0x787C, 0x0EC8, 0x9514, 0xE3A0,
+        0x2CE9, 0x5A5D, 0xC181, 0xB735, 0xE618, 0x90AC, 0x0B70, 0x7DC4, 0xA92A, 0xDF9E, 0x4442, 0x32F6, 0x63DB, 0x156F, 0x8EB3, 0xF807,
+        0x6E9C, 0x1828, 0x83F4, 0xF540, 0xA46D, 0xD2D9, 0x4905, 0x3FB1, 0xEB5F, 0x9DEB, 0x0637, 0x7083, 0x21AE, 0x571A, 0xCCC6, 0xBA72,
+        0x753B, 0x038F, 0x9853, 0xEEE7, 0xBFCA, 0xC97E, 0x52A2, 0x2416, 0xF0F8, 0x864C, 0x1D90, 0x6B24, 0x3A09, 0x4CBD, 0xD761, 0xA1D5,
+        0x59D2, 0x2F66, 0xB4BA, 0xC20E, 0x9323, 0xE597, 0x7E4B, 0x08FF, 0xDC11, 0xAAA5, 0x3179, 0x47CD, 0x16E0, 0x6054, 0xFB88, 0x8D3C,
+        0x4275, 0x34C1, 0xAF1D, 0xD9A9, 0x8884, 0xFE30, 0x65EC, 0x1358, 0xC7B6, 0xB102, 0x2ADE, 0x5C6A, 0x0D47, 0x7BF3, 0xE02F, 0x969B,
+        0xDD38, 0xAB8C, 0x3050, 0x46E4, 0x17C9, 0x617D, 0xFAA1, 0x8C15, 0x58FB, 0x2E4F, 0xB593, 0xC327, 0x920A, 0xE4BE, 0x7F62, 0x09D6,
+        0xC69F, 0xB02B, 0x2BF7, 0x5D43, 0x0C6E, 0x7ADA, 0xE106, 0x97B2, 0x435C, 0x35E8, 0xAE34, 0xD880, 0x89AD, 0xFF19, 0x64C5, 0x1271,
+        0xEA76, 0x9CC2, 0x071E, 0x71AA, 0x2087, 0x5633, 0xCDEF, 0xBB5B, 0x6FB5, 0x1901, 0x82DD, 0xF469, 0xA544, 0xD3F0, 0x482C, 0x3E98,
+        0xF1D1, 0x8765, 0x1CB9, 0x6A0D, 0x3B20, 0x4D94, 0xD648, 0xA0FC, 0x7412, 0x02A6, 0x997A, 0xEFCE, 0xBEE3, 0xC857, 0x538B, 0x253F,
+        0xB3A4, 0xC510, 0x5ECC, 0x2878, 0x7955, 0x0FE1, 0x943D, 0xE289, 0x3667, 0x40D3, 0xDB0F, 0xADBB, 0xFC96, 0x8A22, 0x11FE, 0x674A,
+        0xA803, 0xDEB7, 0x456B, 0x33DF, 0x62F2, 0x1446, 0x8F9A, 0xF92E, 0x2DC0, 0x5B74, 0xC0A8, 0xB61C, 0xE731, 0x9185, 0x0A59, 0x7CED,
+        0x84EA, 0xF25E, 0x6982, 0x1F36, 0x4E1B, 0x38AF, 0xA373, 0xD5C7, 0x0129, 0x779D, 0xEC41, 0x9AF5, 0xCBD8, 0xBD6C, 0x26B0, 0x5004,
+        0x9F4D, 0xE9F9, 0x7225, 0x0491, 0x55BC, 0x2308, 0xB8D4, 0xCE60, 0x1A8E, 0x6C3A, 0xF7E6, 0x8152, 0xD07F, 0xA6CB, 0x3D17, 0x4BA3
+    }
 };
 
-EZSP::EZSP(QSettings *config, QObject *parent) : Adapter(config, parent), m_timer(new QTimer(this)), m_version(0), m_errorCount(0)
+static const uint8_t randomTable[255] =
+{
+    0x42, 0x21, 0xA8, 0x54, 0x2A, 0x15, 0xB2, 0x59, 0x94, 0x4A, 0x25, 0xAA, 0x55, 0x92, 0x49, 0x9C,
+    0x4E, 0x27, 0xAB, 0xED, 0xCE, 0x67, 0x8B, 0xFD, 0xC6, 0x63, 0x89, 0xFC, 0x7E, 0x3F, 0xA7, 0xEB,
+    0xCD, 0xDE, 0x6F, 0x8F, 0xFF, 0xC7, 0xDB, 0xD5, 0xD2, 0x69, 0x8C, 0x46, 0x23, 0xA9, 0xEC, 0x76,
+    0x3B, 0xA5, 0xEA, 0x75, 0x82, 0x41, 0x98, 0x4C, 0x26, 0x13, 0xB1, 0xE0, 0x70, 0x38, 0x1C, 0x0E,
+    0x07, 0xBB, 0xE5, 0xCA, 0x65, 0x8A, 0x45, 0x9A, 0x4D, 0x9E, 0x4F, 0x9F, 0xF7, 0xC3, 0xD9, 0xD4,
+    0x6A, 0x35, 0xA2, 0x51, 0x90, 0x48, 0x24, 0x12, 0x09, 0xBC, 0x5E, 0x2F, 0xAF, 0xEF, 0xCF, 0xDF,
+    0xD7, 0xD3, 0xD1, 0xD0, 0x68, 0x34, 0x1A, 0x0D, 0xBE, 0x5F, 0x97, 0xF3, 0xC1, 0xD8, 0x6C, 0x36,
+    0x1B, 0xB5, 0xE2, 0x71, 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0xB8, 0x5C, 0x2E, 0x17,
+    0xB3, 0xE1, 0xC8, 0x64, 0x32, 0x19, 0xB4, 0x5A, 0x2D, 0xAE, 0x57, 0x93, 0xF1, 0xC0, 0x60, 0x30,
+    0x18, 0x0C, 0x06, 0x03, 0xB9, 0xE4, 0x72, 0x39, 0xA4, 0x52, 0x29, 0xAC, 0x56, 0x2B, 0xAD, 0xEE,
+    0x77, 0x83, 0xF9, 0xC4, 0x62, 0x31, 0xA0, 0x50, 0x28, 0x14, 0x0A, 0x05, 0xBA, 0x5D, 0x96, 0x4B,
+    0x9D, 0xF6, 0x7B, 0x85, 0xFA, 0x7D, 0x86, 0x43, 0x99, 0xF4, 0x7A, 0x3D, 0xA6, 0x53, 0x91, 0xF0,
+    0x78, 0x3C, 0x1E, 0x0F, 0xBF, 0xE7, 0xCB, 0xDD, 0xD6, 0x6B, 0x8D, 0xFE, 0x7F, 0x87, 0xFB, 0xC5,
+    0xDA, 0x6D, 0x8E, 0x47, 0x9B, 0xF5, 0xC2, 0x61, 0x88, 0x44, 0x22, 0x11, 0xB0, 0x58, 0x2C, 0x16,
+    0x0B, 0xBD, 0xE6, 0x73, 0x81, 0xF8, 0x7C, 0x3E, 0x1F, 0xB7, 0xE3, 0xC9, 0xDC, 0x6E, 0x37, 0xA3,
+    0xE9, 0xCC, 0x66, 0x33, 0xA1, 0xE8, 0x74, 0x3A, 0x1D, 0xB6, 0x5B, 0x95, 0xF2, 0x79, 0x84
+};
+
+static const uint8_t escapeTable[256] =
+{
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x31, 0x00, 0x33, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x3A, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5D, 0x5E, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+EZSP::EZSP(QSettings *config, QObject *parent) : Adapter(config, parent), m_timer(new QTimer(this)), m_acknowledgeTimer(new QTimer(this)), m_version(0), m_sequenceId(0), m_acknowledgeId(0), m_ezspSequenceId(0), m_reject(false), m_errorCount(0), m_addressTableSize(EZSP_DEFAULT_ADDRESS_TABLE_SIZE)
 {
     m_watchdog = config->value("zigbee/watchdog", true).toBool();
 
@@ -51,7 +148,10 @@ EZSP::EZSP(QSettings *config, QObject *parent) : Adapter(config, parent), m_time
     m_values.append({EZSP_VALUE_TRANSIENT_DEVICE_TIMEOUT,           2, qToLittleEndian <quint16> (0x2710)});
 
     connect(m_timer, &QTimer::timeout, this, &EZSP::resetManufacturerCode);
+    connect(m_acknowledgeTimer, &QTimer::timeout, this, &EZSP::acknowledgeTimeout);
+
     m_timer->setSingleShot(true);
+    m_acknowledgeTimer->setSingleShot(true);
 }
 
 bool EZSP::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload)
@@ -73,9 +173,26 @@ bool EZSP::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPointI
     if (m_extendedTimeout)
     {
         quint64 ieeeAddress;
+        int index;
+
         memcpy(&ieeeAddress, m_requestAddress.constData(), sizeof(ieeeAddress));
-        ieeeAddress = qToLittleEndian(qFromBigEndian(ieeeAddress));
-        sendFrame(EZSP_FRAME_SET_EXTENDED_TIMEOUT, QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)).append(1, 0x01));
+        ieeeAddress = qFromBigEndian(ieeeAddress);
+        index = m_timeoutAddresses.indexOf(ieeeAddress);
+
+        if (index < 0)
+        {
+            quint64 value = qToLittleEndian(ieeeAddress);
+
+            if (sendFrame(EZSP_FRAME_SET_EXTENDED_TIMEOUT, QByteArray(reinterpret_cast <char*> (&value), sizeof(value)).append(1, 0x01)))
+            {
+                if (m_timeoutAddresses.count() >= m_addressTableSize)
+                    m_timeoutAddresses.removeFirst();
+
+                m_timeoutAddresses.append(ieeeAddress);
+            }
+        }
+        else
+            m_timeoutAddresses.move(index, m_timeoutAddresses.count() - 1);
     }
 
     return sendFrame(EZSP_FRAME_SEND_UNICAST, QByteArray(reinterpret_cast <char*> (&request), sizeof(request)).append(payload)) && !m_replyStatus;
@@ -160,73 +277,85 @@ void EZSP::resetInterPanChannel(void)
     logWarning << "Reset Inter-PAN request failed";
 }
 
-quint16 EZSP::getCRC(quint8 *data, quint32 length)
+quint16 EZSP::getCRC(const quint8 *data, quint32 length)
 {
     quint16 crc = 0xFFFF;
 
+    while (length >= 4)
+    {
+        crc = crcTable[3][(crc >> 8) ^ data[0]] ^ crcTable[2][(crc & 0xFF) ^ data[1]] ^ crcTable[1][data[2]] ^ crcTable[0][data[3]];
+        data += 4;
+        length -= 4;
+    }
+
     while (length--)
-        crc = static_cast <quint16> (crc << 8) ^ crcTable[(crc >> 8) ^ *data++];
+        crc = static_cast <quint16> (crc << 8) ^ crcTable[0][(crc >> 8) ^ *data++];
 
     return qToBigEndian(crc);
 }
 
 void EZSP::randomize(QByteArray &payload)
 {
-    quint8 *buffer = reinterpret_cast <quint8*> (payload.data()), byte = 0x42;
+    quint8 *buffer = reinterpret_cast <quint8*> (payload.data());
 
-    for (int i = 0; i < payload.length(); i++)
-    {
-        buffer[i] ^= byte;
-        byte = byte & 0x01 ? (byte >> 1) ^ 0xB8 : byte >> 1;
-    }
+    for (int i = 0, j = 0; i < payload.length(); i++, j = j < static_cast <int> (sizeof(randomTable)) - 1 ? j + 1 : 0)
+        buffer[i] ^= randomTable[j];
 }
 
 bool EZSP::sendFrame(quint16 frameId, const QByteArray &data, bool version)
 {
+    quint8 sequence = m_ezspSequenceId++;
     QByteArray payload;
-    quint8 control = (m_sequenceId & 0x07) << 4 | m_acknowledgeId;
+    qint64 deadline;
 
     if (version)
     {
-        logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%02x", m_sequenceId) << "(legacy version request)";
-        payload.append(static_cast <char> (m_sequenceId));
+        logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%02x", sequence) << "(legacy version request)";
+        payload.append(static_cast <char> (sequence));
         payload.append(2, 0x00);
     }
     else
     {
         ezspHeaderStruct header;
 
-        header.sequence = m_sequenceId;
+        header.sequence = sequence;
         header.frameControlLow = 0x00;
         header.frameControlHigh = 0x01;
         header.frameId = qToLittleEndian(frameId);
 
-        logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%02x", m_sequenceId) <<  QString::asprintf("0x%02x%02x", header.frameControlLow, header.frameControlHigh) << QString::asprintf("0x%04x", frameId) << data.toHex(':');
+        logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%02x", sequence) <<  QString::asprintf("0x%02x%02x", header.frameControlLow, header.frameControlHigh) << QString::asprintf("0x%04x", frameId) << data.toHex(':');
         payload.append(reinterpret_cast <char*> (&header), sizeof(header));
     }
 
     randomize(payload.append(data));
+    deadline = QDateTime::currentMSecsSinceEpoch() + ASH_REQUEST_TIMEOUT * ASH_REQUEST_RETRIES;
 
-    for (quint8 i = 0; i < ASH_REQUEST_RETRIES; i++)
-    {
-        m_replyStatus = 0xFF;
-        m_replyData.clear();
-        m_replyReceived = false;
+    while (commandPending())
+        if (!waitForReply(deadline))
+            break;
 
-        sendRequest(control, payload);
+    if (!commandPending())
+    {
+        m_sequences.append(sequence);
+        sendPacket(payload);
 
-        if (waitForSignal(this, SIGNAL(dataReceived()), ASH_REQUEST_TIMEOUT) && m_replyReceived)
-        {
-            m_errorCount = 0;
-            return true;
-        }
+        while (m_sequences.contains(sequence) && !m_replies.contains(sequence))
+            if (!waitForReply(deadline))
+                break;
 
-        if (m_errorReceived)
-            break;
+        m_sequences.removeOne(sequence);
+    }
 
-        control |= 0x08;
+    if (m_replies.contains(sequence))
+    {
+        m_replyData = m_replies.take(sequence);
+        m_replyStatus = m_replyData.isEmpty() ? 0xFF : static_cast <quint8> (m_replyData.at(0));
+        m_errorCount = 0;
+        return true;
     }
 
+    m_replyStatus = 0xFF;
+    m_replyData.clear();
     m_errorCount++;
 
     if (m_watchdog && m_errorCount == EZSP_MAX_ERRORS)
@@ -235,33 +364,127 @@ bool EZSP::sendFrame(quint16 frameId, const QByteArray &data, bool version)
     return false;
 }
 
+bool EZSP::commandPending(void)
+{
+    for (int i = 0; i < m_sequences.count(); i++)
+        if (!m_replies.contains(m_sequences.at(i)))
+            return true;
+
+    return false;
+}
+
+bool EZSP::waitForReply(qint64 deadline)
+{
+    qint64 timeout = deadline - QDateTime::currentMSecsSinceEpoch();
+    return timeout > 0 && waitForSignal(this, SIGNAL(dataReceived()), static_cast <int> (timeout));
+}
+
+QByteArray EZSP::stuffData(const QByteArray &request)
+{
+    const quint8 *data = reinterpret_cast <const quint8*> (request.constData());
+    QByteArray buffer(request.length() * 2 + 1, 0x00);
+    char *output = buffer.data();
+    int length = 0;
+
+    for (int i = 0; i < request.length(); i++)
+    {
+        if (escapeTable[data[i]])
+        {
+            output[length++] = 0x7D;
+            output[length++] = static_cast <char> (escapeTable[data[i]]);
+            continue;
+        }
+
+        output[length++] = static_cast <char> (data[i]);
+    }
+
+    output[length++] = static_cast <char> (ASH_PACKET_FLAG);
+    buffer.resize(length);
+
+    return buffer;
+}
+
 void EZSP::sendRequest(quint8 control, const QByteArray &payload)
 {
-    QByteArray request, buffer;
+    QByteArray request;
     quint16 crc;
 
     request.append(static_cast <quint8> (control));
     request.append(payload);
 
-    crc = getCRC(reinterpret_cast <quint8*> (request.data()), request.length());
+    crc = getCRC(reinterpret_cast <const quint8*> (request.constData()), request.length());
     request.append(reinterpret_cast <char*> (&crc), sizeof(crc));
 
-    for (int i = 0; i < request.length(); i++)
+    sendData(stuffData(request));
+}
+
+void EZSP::transmitFrame(ashFrameStruct &frame, bool retransmit)
+{
+    frame.time = QDateTime::currentMSecsSinceEpoch();
+    sendRequest(static_cast <quint8> (frame.id << 4 | (retransmit ? 0x08 : 0x00) | m_acknowledgeId), frame.payload);
+}
+
+void EZSP::sendPacket(const QByteArray &payload)
+{
+    ashFrameStruct frame;
+
+    frame.id = m_sequenceId;
+    frame.payload = payload;
+    frame.retries = 0;
+
+    m_sequenceId = (m_sequenceId + 1) & 0x07;
+
+    transmitFrame(frame);
+    m_window.append(frame);
+
+    if (m_acknowledgeTimer->isActive())
+        return;
+
+    m_acknowledgeTimer->start(ASH_ACKNOWLEDGE_TIMEOUT);
+}
+
+void EZSP::retransmitWindow(void)
+{
+    for (int i = 0; i < m_window.count(); i++)
     {
-        switch (request.at(i))
-        {
-            case 0x11: buffer.append(0x7D).append(0x31); break;
-            case 0x13: buffer.append(0x7D).append(0x33); break;
-            case 0x18: buffer.append(0x7D).append(0x38); break;
-            case 0x1A: buffer.append(0x7D).append(0x3A); break;
-            case 0x7D: buffer.append(0x7D).append(0x5D); break;
-            case 0x7E: buffer.append(0x7D).append(0x5E); break;
-            default:   buffer.append(request.at(i)); break;
-        }
+        logDebug(m_adapterDebug) << "Retransmitting frame:" << QString::asprintf("%d", m_window.at(i).id).toUtf8().constData();
+        m_window[i].retries++;
+        transmitFrame(m_window[i], true);
     }
 
-    m_errorReceived = false;
-    sendData(buffer.append(static_cast <char> (ASH_PACKET_FLAG)));
+    if (m_window.isEmpty())
+        return;
+
+    m_acknowledgeTimer->start(ASH_ACKNOWLEDGE_TIMEOUT);
+}
+
+void EZSP::acknowledgeWindow(quint8 acknowledgeId)
+{
+    bool check = acknowledgeId == m_sequenceId;
+
+    for (int i = 0; i < m_window.count() && !check; i++)
+        if (m_window.at(i).id == acknowledgeId)
+            check = true;
+
+    if (!check)
+        return;
+
+    while (!m_window.isEmpty() && m_window.first().id != acknowledgeId)
+        m_window.removeFirst();
+
+    m_acknowledgeTimer->stop();
+
+    if (!m_window.isEmpty())
+        m_acknowledgeTimer->start(static_cast <int> (qMax <qint64> (0, ASH_ACKNOWLEDGE_TIMEOUT - QDateTime::currentMSecsSinceEpoch() + m_window.first().time)));
+}
+
+void EZSP::clearWindow(void)
+{
+    m_acknowledgeTimer->stop();
+    m_window.clear();
+    m_sequences.clear();
+    m_replies.clear();
+    m_reject = false;
 }
 
 void EZSP::parsePacket(const QByteArray &payload)
@@ -271,18 +494,15 @@ void EZSP::parsePacket(const QByteArray &payload)
 
     logDebug(m_adapterDebug) << "<--" << QString::asprintf("0x%02x", header->sequence) <<  QString::asprintf("0x%02x%02x", header->frameControlLow, header->frameControlHigh) << QString::asprintf("0x%04x", qFromLittleEndian(header->frameId)) << data.toHex(':');
 
-    if (!(header->frameControlLow & 0x18) && header->sequence == m_sequenceId)
+    if (!(header->frameControlLow & 0x18) && m_sequences.contains(header->sequence))
     {
         if (header->frameControlHigh & 0x01)
-        {
-            m_replyStatus = static_cast <quint8> (data.at(0));
-            m_replyData = data;
-        }
+            m_replies.insert(header->sequence, data);
         else
+        {
             m_version = static_cast <quint8> (payload.at(3));
-
-        m_sequenceId++;
-        m_replyReceived = true;
+            m_replies.insert(header->sequence, QByteArray());
+        }
 
         emit dataReceived();
         return;
@@ -301,6 +521,8 @@ void EZSP::parsePacket(const QByteArray &payload)
         {
             const ezspTrustCenterJoinStruct *message = reinterpret_cast <const ezspTrustCenterJoinStruct*> (data.constData());
 
+            m_timeoutAddresses.removeAll(qFromLittleEndian(message->ieeeAddress));
+
             switch (message->status)
             {
                 case EZSP_TRUST_CENTER_UNSECURED_JOIN:
@@ -358,6 +580,9 @@ void EZSP::parsePacket(const QByteArray &payload)
                 break;
             }
 
+            if (qFromLittleEndian(message->clusterId) & 0x8000 && payload.length() > 1 && payload.at(1))
+                emit zdoRequestFailed(static_cast <quint8> (payload.at(0)), static_cast <quint8> (payload.at(1)));
+
             emit zdoMessageReveived(qFromLittleEndian(message->networkAddress), qFromLittleEndian(message->clusterId), payload.mid(1));
             break;
         }
@@ -541,6 +766,13 @@ bool EZSP::startCoordinator(void)
         logWarning << "Set config" << QString::asprintf("0x%02x", request.id) << "request failed";
     }
 
+    if (sendFrame(EZSP_FRAME_GET_CONFIGURATION_VALUE, QByteArray(1, EZSP_CONFIG_ADDRESS_TABLE_SIZE)) && !m_replyStatus && m_replyData.length() >= 3)
+    {
+        quint16 value;
+        memcpy(&value, m_replyData.constData() + 1, sizeof(value));
+        m_addressTableSize = qMax <quint16> (1, qFromLittleEndian(value));
+    }
+
     for (int i = 0; i < m_policy.length(); i++)
     {
         ezspSetConfigStruct request = m_policy.at(i);
@@ -687,7 +919,7 @@ bool EZSP::startCoordinator(void)
     m_ieeeAddress = QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress));
 
     setManufacturerCode(MANUFACTURER_CODE_SILABS);
-    emit coordinatorReady();
+    emit coordinatorReady(m_ieeeAddress, m_manufacturerName, m_modelName, m_firmware);
     return true;
 }
 
@@ -705,7 +937,7 @@ void EZSP::handleError(const QString &reason)
 {
     logWarning << reason.toUtf8().constData();
 
-    m_errorReceived = true;
+    clearWindow();
     emit dataReceived();
 
     reset();
@@ -716,65 +948,86 @@ void EZSP::softReset(void)
     sendRequest(ASH_CONTROL_RST);
 }
 
-void EZSP::parseData(QByteArray &buffer)
+int EZSP::parseData(const QByteArray &buffer)
 {
-    while (!buffer.isEmpty())
+    int offset = 0;
+
+    while (offset < buffer.length())
     {
-        quint16 length, crc;
+        const char *frame;
+        char *data;
+        int length, size = 0;
+        quint8 value;
+        quint16 crc;
         QByteArray packet;
 
-        if (buffer.startsWith(QByteArray::fromHex("1ac102")) || buffer.startsWith(QByteArray::fromHex("1ac202")))
-            buffer.remove(0, 1);
+        if (buffer.length() - offset > 2 && buffer.at(offset) == 0x1A && (buffer.at(offset + 1) == static_cast <char> (0xC1) || buffer.at(offset + 1) == static_cast <char> (0xC2)) && buffer.at(offset + 2) == 0x02)
+            offset++;
 
-        if (buffer.length() < 4 || !buffer.contains(static_cast <char> (ASH_PACKET_FLAG)))
-            return;
+        length = buffer.indexOf(static_cast <char> (ASH_PACKET_FLAG), offset) - offset;
 
-        length = static_cast <quint16> (buffer.indexOf(ASH_PACKET_FLAG));
-        logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length + 1).toHex(':');
+        if (length < 0)
+            break;
+
+        if (length < 3)
+        {
+            offset += length + 1;
+            continue;
+        }
+
+        logDebug(m_portDebug) << "Frame received:" << buffer.mid(offset, length + 1).toHex(':');
+
+        frame = buffer.constData() + offset;
+        packet.resize(length);
+        data = packet.data();
 
         for (int i = 0; i < length; i++)
         {
-            if (buffer.at(i) == 0x11 || buffer.at(i) == 0x13)
+            if (frame[i] == 0x11 || frame[i] == 0x13)
                 continue;
 
-            if (buffer.at(i) != 0x7D)
+            if (frame[i] != 0x7D)
             {
-                packet.append(buffer.at(i));
+                data[size++] = frame[i];
                 continue;
             }
 
-            switch (buffer.at(++i))
+            value = static_cast <quint8> (frame[++i]) ^ 0x20;
+
+            if (escapeTable[value])
             {
-                case 0x31: packet.append(0x11); break;
-                case 0x33: packet.append(0x13); break;
-                case 0x38: packet.append(0x18); break;
-                case 0x3A: packet.append(0x1A); break;
-                case 0x5D: packet.append(0x7D); break;
-                case 0x5E: packet.append(0x7E); break;
+                data[size++] = static_cast <char> (value);
+                continue;
+            }
 
-                default:
+            if (frame[i] != 0x11 && frame[i] != 0x13)
+            {
+                handleError(QString("Frame %1 unstaffing failed at position %2").arg(QString(buffer.mid(offset, length + 1).toHex(':'))).arg(i));
+                return offset + length + 1;
+            }
+        }
 
-                    if (buffer.at(i) != 0x11 && buffer.at(i) != 0x13)
-                    {
-                        handleError(QString("Frame %1 unstaffing failed at position %2").arg(QString(buffer.mid(0, length + 1).toHex(':'))).arg(i));
-                        return;
-                    }
+        packet.resize(size);
 
-                    break;
-            }
+        if (packet.length() < 3)
+        {
+            offset += length + 1;
+            continue;
         }
 
         memcpy(&crc, packet.constData() + packet.length() - 2, sizeof(crc));
 
-        if (crc != getCRC(reinterpret_cast <quint8*> (packet.data()), packet.length() - 2))
+        if (crc != getCRC(reinterpret_cast <const quint8*> (packet.constData()), packet.length() - 2))
         {
             handleError(QString("Packet %1 CRC mismatch").arg(QString(packet.toHex(':'))));
-            return;
+            return offset + length + 1;
         }
 
         m_queue.enqueue(packet);
-        buffer.remove(0, length + 1);
+        offset += length + 1;
     }
+
+    return offset;
 }
 
 bool EZSP::permitJoin(bool enabled)
@@ -814,6 +1067,29 @@ void EZSP::resetManufacturerCode(void)
     setManufacturerCode(MANUFACTURER_CODE_SILABS);
 }
 
+void EZSP::acknowledgeTimeout(void)
+{
+    if (m_window.isEmpty())
+        return;
+
+    if (m_window.first().retries < ASH_REQUEST_RETRIES - 1)
+    {
+        retransmitWindow();
+        return;
+    }
+
+    logWarning << "Frame" << QString::asprintf("%d", m_window.first().id).toUtf8().constData() << "not acknowledged after" << ASH_REQUEST_RETRIES << "attempts, resetting ASH connection";
+
+    clearWindow();
+    emit dataReceived();
+
+    m_buffer.clear();
+    m_resetTimer->start(RESET_TIMEOUT);
+
+    emit adapterReset();
+    softReset();
+}
+
 void EZSP::handleQueue(void)
 {
     while (!m_queue.isEmpty())
@@ -824,8 +1100,30 @@ void EZSP::handleQueue(void)
         if (!(control & 0x80))
         {
             QByteArray payload = packet.mid(1, packet.length() - 3);
+            quint8 frameId = (control >> 4) & 0x07;
+
+            acknowledgeWindow(control & 0x07);
+
+            if (frameId != m_acknowledgeId)
+            {
+                if (control & 0x08 && frameId == ((m_acknowledgeId - 1) & 0x07))
+                {
+                    sendRequest(ASH_CONTROL_ACK | m_acknowledgeId);
+                    continue;
+                }
+
+                if (!m_reject)
+                {
+                    logDebug(m_adapterDebug) << "Received out of sequence frame:" << QString::asprintf("%d, %d", m_acknowledgeId, frameId).toUtf8().constData();
+                    sendRequest(ASH_CONTROL_NAK | m_acknowledgeId);
+                    m_reject = true;
+                }
+
+                continue;
+            }
 
-            m_acknowledgeId = ((control >> 4) + 1) & 0x07;
+            m_reject = false;
+            m_acknowledgeId = (frameId + 1) & 0x07;
             sendRequest(ASH_CONTROL_ACK | m_acknowledgeId);
 
             randomize(payload);
@@ -836,22 +1134,27 @@ void EZSP::handleQueue(void)
 
         if ((control & 0xE0) == ASH_CONTROL_ACK)
         {
-            m_replyReceived = true;
-            emit dataReceived();
+            acknowledgeWindow(control & 0x07);
             continue;
         }
 
         if ((control & 0xE0) == ASH_CONTROL_NAK)
         {
             logDebug(m_adapterDebug) << "Received NAK frame:" << QString::asprintf("%d, %d", m_acknowledgeId, control & 0x07).toUtf8().constData();
-            emit dataReceived();
-            break;
+            acknowledgeWindow(control & 0x07);
+            retransmitWindow();
+            continue;
         }
 
         if (control == ASH_CONTROL_RSTACK)
         {
+            clearWindow();
+
             m_sequenceId = 0;
             m_acknowledgeId = 0;
+            m_ezspSequenceId = 0;
+
+            m_timeoutAddresses.clear();
 
             if (!startCoordinator())
             {
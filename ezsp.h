@@ -3,6 +3,7 @@
 
 #define ASH_REQUEST_TIMEOUT                                 2000
 #define ASH_REQUEST_RETRIES                                 3
+#define ASH_ACKNOWLEDGE_TIMEOUT                             800
 #define ASH_PACKET_FLAG                                     0x7E
 
 #define ASH_CONTROL_ACK                                     0x80
@@ -12,6 +13,7 @@
 #define ASH_CONTROL_ERROR                                   0xC2
 
 #define EZSP_MAX_ERRORS                                     10
+#define EZSP_DEFAULT_ADDRESS_TABLE_SIZE                     8
 
 #define EZSP_FRAME_VERSION                                  0x0000
 #define EZSP_FRAME_REGISTER_ENDPOINT                        0x0002
@@ -31,6 +33,7 @@
 #define EZSP_FRAME_MESSAGE_SENT_HANDLER                     0x003F
 #define EZSP_FRAME_INCOMING_MESSAGE_HANDLER                 0x0045
 #define EZSP_FRAME_MAC_FILTER_MATCH_MESSAGE_HANDLER         0x0046
+#define EZSP_FRAME_GET_CONFIGURATION_VALUE                  0x0052
 #define EZSP_FRAME_SET_CONFIG                               0x0053
 #define EZSP_FRAME_SET_POLICY                               0x0055
 #define EZSP_FRAME_SET_SOURCE_ROUTE_DISCOVERY_MODE          0x005A
@@ -51,6 +54,7 @@
 #define EZSP_FRAME_EXPORT_KEY                               0x0114
 
 #define EZSP_CONFIG_PACKET_BUFFER_COUNT                     0x01
+#define EZSP_CONFIG_ADDRESS_TABLE_SIZE                      0x05
 #define EZSP_CONFIG_STACK_PROFILE                           0x0C
 #define EZSP_CONFIG_SECURITY_LEVEL                          0x0D
 #define EZSP_CONFIG_INDIRECT_TRANSMISSION_TIMEOUT           0x12
@@ -304,6 +308,14 @@ struct ezspVersionStruct
 
 #pragma pack(pop)
 
+struct ashFrameStruct
+{
+    quint8     id;
+    QByteArray payload;
+    qint64     time;
+    quint8     retries;
+};
+
 class EZSP : public Adapter
 {
     Q_OBJECT
@@ -321,26 +333,42 @@ public:
     bool setInterPanChannel(quint8 channel) override;
     void resetInterPanChannel(void) override;
 
+    static quint16 getCRC(const quint8 *data, quint32 length);
+    static void randomize(QByteArray &data);
+    static QByteArray stuffData(const QByteArray &request);
+
 private:
 
-    QTimer *m_timer;
-    quint8 m_version, m_stackStatus, m_sequenceId, m_acknowledgeId;
-    bool m_watchdog;
+    QTimer *m_timer, *m_acknowledgeTimer;
+    quint8 m_version, m_stackStatus, m_sequenceId, m_acknowledgeId, m_ezspSequenceId;
+    bool m_watchdog, m_reject;
 
     QByteArray m_replyData;
     quint8 m_errorCount;
-    bool m_replyReceived, m_errorReceived;
+
+    QList <quint8> m_sequences;
+    QMap <quint8, QByteArray> m_replies;
+
+    quint16 m_addressTableSize;
+    QList <quint64> m_timeoutAddresses;
+
+    QList <ashFrameStruct> m_window;
 
     QList <ezspSetConfigStruct> m_config, m_policy;
     QList <ezspSetValueStruct> m_values;
 
-    quint16 getCRC(quint8 *data, quint32 length);
-    void randomize(QByteArray &data);
-
     bool sendFrame(quint16 frameId, const QByteArray &data = QByteArray(), bool version = false);
+    bool commandPending(void);
+    bool waitForReply(qint64 deadline);
     void sendRequest(quint8 control, const QByteArray &payload = QByteArray());
     void parsePacket(const QByteArray &payload);
 
+    void transmitFrame(ashFrameStruct &frame, bool retransmit = false);
+    void sendPacket(const QByteArray &payload);
+    void retransmitWindow(void);
+    void acknowledgeWindow(quint8 acknowledgeId);
+    void clearWindow(void);
+
     bool startNetwork(quint64 extendedPanId);
     bool startCoordinator(void);
 
@@ -348,12 +376,13 @@ private:
     void handleError(const QString &reason);
 
     void softReset(void) override;
-    void parseData(QByteArray &buffer) override;
+    int parseData(const QByteArray &buffer) override;
     bool permitJoin(bool enabled) override;
 
 private slots:
 
     void resetManufacturerCode(void);
+    void acknowledgeTimeout(void);
     void handleQueue(void) override;
 
 signals:
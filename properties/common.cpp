@@ -18,7 +18,7 @@ void Properties::BatteryPercentage::parseAttribte(quint16, quint16 attributeId,
     if (attributeId != 0x0021)
         return;
 
-    m_value = static_cast <quint8> (data.at(0)) / (option().toMap().value("undivided").toBool() ? 1.0 : 2.0);
+    m_value = static_cast <quint8> (data.at(0)) / (m_options.value("undivided").toBool() ? 1.0 : 2.0);
 }
 
 void Properties::DeviceTemperature::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
@@ -73,7 +73,7 @@ void Properties::AnalogOutput::parseAttribte(quint16, quint16 attributeId, const
 void Properties::CoverPosition::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
 {
     QMap <QString, QVariant> map;
-    qint8 value = static_cast <quint8> (option("invertCover").toBool() ? data.at(0) : 100 - data.at(0));
+    qint8 value = static_cast <quint8> (m_invertCover ? data.at(0) : 100 - data.at(0));
 
     if (attributeId != 0x0008 || value == meta().value("position", 0xFF).toInt())
         return;
@@ -86,7 +86,7 @@ void Properties::CoverPosition::parseAttribte(quint16, quint16 attributeId, cons
 void Properties::CoverTilt::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
 {
     QMap <QString, QVariant> map;
-    qint8 value = static_cast <quint8> (option("invertCover").toBool() ? data.at(0) : 100 - data.at(0));
+    qint8 value = static_cast <quint8> (m_invertCover ? data.at(0) : 100 - data.at(0));
 
     if (attributeId != 0x0009 || value == meta().value("tilt", 0xFF).toInt())
         return;
@@ -218,7 +218,7 @@ void Properties::Illuminance::parseAttribte(quint16, quint16 attributeId, const
         return;
 
     memcpy(&value, data.constData(), data.length());
-    m_value = option().toMap().value("raw").toBool() ? qFromLittleEndian(value) : static_cast <quint32> (value ? pow(10, (qFromLittleEndian(value) - 1) / 10000.0) : 0);
+    m_value = m_options.value("raw").toBool() ? qFromLittleEndian(value) : static_cast <quint32> (value ? pow(10, (qFromLittleEndian(value) - 1) / 10000.0) : 0);
 }
 
 void Properties::Temperature::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
@@ -251,7 +251,7 @@ void Properties::Humidity::parseAttribte(quint16, quint16 attributeId, const QBy
         return;
 
     memcpy(&value, data.constData(), data.length());
-    m_value = qFromLittleEndian(value) / option("humidityDivider", 100).toDouble();
+    m_value = qFromLittleEndian(value) / (m_divider ? m_divider : 100);
 }
 
 void Properties::Occupancy::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
@@ -314,7 +314,7 @@ void Properties::PM25::parseAttribte(quint16, quint16 attributeId, const QByteAr
 
 void Properties::Energy::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
 {
-    double divider = option("energyDivider", 1).toDouble();
+    double divider = m_divider ? m_divider : 1;
     qint64 value = 0;
 
     if (attributeId != 0x0000 || static_cast <size_t> (data.length()) > sizeof(value))
@@ -326,7 +326,7 @@ void Properties::Energy::parseAttribte(quint16, quint16 attributeId, const QByte
 
 void Properties::Voltage::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
 {
-    double divider = option("voltageDivider", 1).toDouble();
+    double divider = m_divider ? m_divider : 1;
     qint16 value = 0;
 
     if (attributeId != 0x0505 || static_cast <size_t> (data.length()) > sizeof(value))
@@ -338,7 +338,7 @@ void Properties::Voltage::parseAttribte(quint16, quint16 attributeId, const QByt
 
 void Properties::Current::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
 {
-    double divider = option("currentDivider", 1).toDouble();
+    double divider = m_divider ? m_divider : 1;
     qint16 value = 0;
 
     if (attributeId != 0x0508 || static_cast <size_t> (data.length()) > sizeof(value))
@@ -350,7 +350,7 @@ void Properties::Current::parseAttribte(quint16, quint16 attributeId, const QByt
 
 void Properties::Power::parseAttribte(quint16, quint16 attributeId, const QByteArray &data)
 {
-    double divider = option("powerDivider", 1).toDouble();
+    double divider = m_divider ? m_divider : 1;
     qint16 value = 0;
 
     if (attributeId != 0x050B || static_cast <size_t> (data.length()) > sizeof(value))
@@ -371,7 +371,7 @@ void ChildLock::parseAttribte(quint16, quint16 attributeId, const QByteArray &da
 void Properties::Scene::parseCommand(quint16, quint8 commandId, const QByteArray &payload)
 {
     const recallSceneStruct *command = reinterpret_cast <const recallSceneStruct*> (payload.constData());
-    QVariant name = option().toMap().value("enum").toMap().value(QString::number(command->sceneId));
+    QVariant name = m_options.value("enum").toMap().value(QString::number(command->sceneId));
 
     if (commandId != 0x05)
         return;
@@ -362,7 +362,7 @@ void PropertiesLUMI::Cover::parseAttribte(quint16, quint16 attributeId, const QB
     if (value > 100)
         return;
 
-    if (!option("invertCover").toBool())
+    if (!m_invertCover)
         value = 100 - value;
 
     map.insert("cover", value ? "open" : "closed");
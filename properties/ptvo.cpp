@@ -21,7 +21,7 @@ void PropertiesPTVO::AnalogInput::parseAttribte(quint16, quint16 attributeId, co
                 return;
 
             memcpy(&value, data.constData(), data.length());
-            (m_unit.isEmpty() ? m_value : m_buffer) = qFromLittleEndian(value) / option(QString(m_name).append("Divider"), 1).toDouble();
+            (m_unit.isEmpty() ? m_value : m_buffer) = qFromLittleEndian(value) / (m_divider ? m_divider : 1);
             break;
         }
 
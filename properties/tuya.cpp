@@ -65,7 +65,7 @@ QVariant PropertiesTUYA::Data::parseData(const tuyaHeaderStruct *header, const Q
 void PropertiesTUYA::DataPoints::update(quint8 dataPoint, const QVariant &data)
 {
     QMap <QString, QVariant> map = m_value.toMap();
-    QList <QVariant> list = option().toMap().value(QString::number(dataPoint)).toList();
+    QList <QVariant> list = m_options.value(QString::number(dataPoint)).toList();
     QList <QString> types = {"raw", "bool", "value", "enum"};
 
     for (int i = 0; i < list.count(); i++)
@@ -250,7 +250,7 @@ void PropertiesTUYA::CoverMotor::update(quint8 dataPoint, const QVariant &data)
 
     if (dataPoint == 0x02 || dataPoint == 0x03)
     {
-        quint8 value = static_cast <quint8> (option("invertCover").toBool() ? data.toInt() : 100 - data.toInt());
+        quint8 value = static_cast <quint8> (m_invertCover ? data.toInt() : 100 - data.toInt());
         map.insert("cover", value ? "open" : "closed");
         map.insert("position", static_cast <quint8> (value));
     }
@@ -268,9 +268,9 @@ void PropertiesTUYA::CoverSwitch::parseAttribte(quint16, quint16 attributeId, co
 
             switch (data.at(0))
             {
-                case 0: map.insert("event", option("invertCover").toBool() ? "close" : "open"); break;
+                case 0: map.insert("event", m_invertCover ? "close" : "open"); break;
                 case 1: map.insert("event", "stop"); break;
-                case 2: map.insert("event", option("invertCover").toBool() ? "open" : "close"); break;
+                case 2: map.insert("event", m_invertCover ? "open" : "close"); break;
             }
 
             break;
@@ -110,6 +110,14 @@ void PropertyObject::registerMetaTypes(void)
     qRegisterMetaType <PropertiesIKEA::ArrowAction>                 ("ikeaArrowActionProperty");
 }
 
+void PropertyObject::setupOptions(void)
+{
+    m_options = option().toMap();
+    m_divider = option(QString(m_name).append("Divider")).toDouble();
+    m_invertCover = option("invertCover").toBool();
+    m_iasAlarm2 = option("iasAlarm2").toBool();
+}
+
 quint8 PropertyObject::percentage(double min, double max, double value)
 {
     if (value < min)
@@ -123,7 +131,7 @@ quint8 PropertyObject::percentage(double min, double max, double value)
 
 QVariant PropertyObject::enumValue(const QString &name, int index)
 {
-    QVariant data = option(name).toMap().value("enum");
+    QVariant data = (name == m_name ? m_options : option(name).toMap()).value("enum");
 
     switch (data.type())
     {
@@ -21,10 +21,10 @@ class PropertyObject : public AbstractMetaObject
 public:
 
     PropertyObject(const QString &name, QList <quint16> clusters = {}) :
-        AbstractMetaObject(name), m_clusters(clusters), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0) {}
+        AbstractMetaObject(name), m_clusters(clusters), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0), m_divider(0), m_invertCover(false), m_iasAlarm2(false) {}
 
     PropertyObject(const QString &name, quint16 clusterId) :
-        AbstractMetaObject(name), m_clusters({clusterId}), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0) {}
+        AbstractMetaObject(name), m_clusters({clusterId}), m_multiple(false), m_timeout(0), m_time(0), m_transactionId(0), m_divider(0), m_invertCover(false), m_iasAlarm2(false) {}
 
     virtual ~PropertyObject(void) {}
     virtual void parseAttribte(quint16, quint16, const QByteArray &) {}
@@ -50,6 +50,8 @@ public:
     inline void clearValue(void) { m_value = QVariant(); }
 
     inline QQueue <PropertyRequest> &queue(void) { return m_queue; }
+
+    void setupOptions(void);
     static void registerMetaTypes(void);
 
 protected:
@@ -63,6 +65,10 @@ protected:
     quint8 m_transactionId;
     QVariant m_value;
 
+    QMap <QString, QVariant> m_options;
+    double m_divider;
+    bool m_invertCover, m_iasAlarm2;
+
     QQueue <PropertyRequest> m_queue;
 
     quint8 percentage(double min, double max, double value);
@@ -0,0 +1,390 @@
+#include <QtEndian>
+#include "ezsp.h"
+#include "logger.h"
+
+EZSPSimulator::EZSPSimulator(QSettings *config, QObject *parent) : Simulator(config, parent), m_sequenceId(0), m_acknowledgeId(0), m_reject(false), m_joined(true)
+{
+    memset(&m_network, 0, sizeof(m_network));
+
+    m_network.extendedPanId = qToLittleEndian(m_ieeeAddress);
+    m_network.panId = qToLittleEndian(m_panId);
+    m_network.channel = m_channel;
+    m_network.channelList = qToLittleEndian <quint32> (1 << m_channel);
+}
+
+quint16 EZSPSimulator::getCRC(const quint8 *data, quint32 length)
+{
+    quint16 crc = 0xFFFF;
+
+    while (length--)
+    {
+        crc ^= *data++ << 8;
+
+        for (quint8 i = 0; i < 8; i++)
+            crc = crc & 0x8000 ? static_cast <quint16> (crc << 1) ^ 0x1021 : static_cast <quint16> (crc << 1);
+    }
+
+    return qToBigEndian(crc);
+}
+
+void EZSPSimulator::randomize(QByteArray &data)
+{
+    quint8 value = 0x42;
+
+    for (int i = 0; i < data.length(); i++)
+    {
+        data[i] = data.at(i) ^ static_cast <char> (value);
+        value = value & 0x01 ? (value >> 1) ^ 0xB8 : value >> 1;
+    }
+}
+
+void EZSPSimulator::sendRequest(quint8 control, const QByteArray &payload)
+{
+    QByteArray request = QByteArray(1, static_cast <char> (control)).append(payload), buffer;
+    quint16 crc = getCRC(reinterpret_cast <const quint8*> (request.constData()), request.length());
+
+    request.append(reinterpret_cast <char*> (&crc), sizeof(crc));
+
+    if (control == ASH_CONTROL_RSTACK)
+        buffer.append(1, 0x1A);
+
+    for (int i = 0; i < request.length(); i++)
+    {
+        switch (static_cast <quint8> (request.at(i)))
+        {
+            case 0x11:
+            case 0x13:
+            case 0x18:
+            case 0x1A:
+            case 0x7D:
+            case 0x7E:
+                buffer.append(1, 0x7D).append(static_cast <char> (request.at(i) ^ 0x20));
+                break;
+
+            default:
+                buffer.append(request.at(i));
+                break;
+        }
+    }
+
+    sendData(buffer.append(static_cast <char> (ASH_PACKET_FLAG)));
+}
+
+void EZSPSimulator::sendFrame(quint8 sequence, quint8 frameControl, quint16 frameId, const QByteArray &data)
+{
+    ezspHeaderStruct header;
+
+    header.sequence = sequence;
+    header.frameControlLow = frameControl;
+    header.frameControlHigh = 0x01;
+    header.frameId = qToLittleEndian(frameId);
+
+    sendPayload(QByteArray(reinterpret_cast <char*> (&header), sizeof(header)).append(data));
+}
+
+void EZSPSimulator::sendPayload(QByteArray payload)
+{
+    randomize(payload);
+    sendRequest(static_cast <quint8> (m_sequenceId << 4 | m_acknowledgeId), payload);
+    m_sequenceId = (m_sequenceId + 1) & 0x07;
+}
+
+void EZSPSimulator::parsePacket(const QByteArray &payload)
+{
+    const ezspHeaderStruct *header = reinterpret_cast <const ezspHeaderStruct*> (payload.constData());
+    QByteArray data = payload.mid(sizeof(ezspHeaderStruct));
+    quint16 frameId;
+
+    if (payload.length() < static_cast <int> (sizeof(ezspHeaderStruct)) || !(header->frameControlHigh & 0x01))
+    {
+        sendPayload(QByteArray(1, static_cast <char> (header->sequence)).append(static_cast <char> (0x80)).append(1, 0x00).append(1, EZSP_SIMULATOR_VERSION).append(QByteArray::fromHex("02706a")));
+        return;
+    }
+
+    frameId = qFromLittleEndian(header->frameId);
+
+    switch (frameId)
+    {
+        case EZSP_FRAME_VERSION:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, EZSP_SIMULATOR_VERSION).append(QByteArray::fromHex("02706a")));
+            break;
+
+        case EZSP_FRAME_GET_VALUE:
+        {
+            ezspVersionStruct version;
+
+            if (data.at(0) != EZSP_VALUE_VERSION_INFO)
+            {
+                sendFrame(header->sequence, 0x80, frameId, QByteArray::fromHex("000100"));
+                break;
+            }
+
+            version.build = qToLittleEndian <quint16> (0x0140);
+            version.major = 6;
+            version.minor = 10;
+            version.patch = 3;
+
+            sendFrame(header->sequence, 0x80, frameId, QByteArray::fromHex("0007").append(reinterpret_cast <char*> (&version), sizeof(version)).append(2, 0x00));
+            break;
+        }
+
+        case EZSP_FRAME_GET_IEEE_ADDRESS:
+        {
+            quint64 ieeeAddress = qToLittleEndian(m_ieeeAddress);
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)));
+            break;
+        }
+
+        case EZSP_FRAME_NETWORK_INIT:
+        {
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, static_cast <char> (m_joined ? 0x00 : EZSP_STATUS_NOT_JOINED)));
+
+            if (m_joined)
+                sendFrame(0x00, 0x90, EZSP_FRAME_STACK_STATUS_HANDLER, QByteArray(1, static_cast <char> (EZSP_STACK_STATUS_NETWORK_UP)));
+
+            break;
+        }
+
+        case EZSP_FRAME_NETWORK_STATUS:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, m_joined ? EZSP_NETWORK_STATUS_JOINED : 0x00));
+            break;
+
+        case EZSP_FRAME_GET_NETWORK_PARAMETERS:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray::fromHex("0001").append(reinterpret_cast <char*> (&m_network), sizeof(m_network)));
+            break;
+
+        case EZSP_FRAME_GET_KEY:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray::fromHex("00000003").append(m_networkKey).append(13, 0x00));
+            break;
+
+        case EZSP_FRAME_SET_INITIAL_SECURITY_STATE:
+        {
+            const ezspSetInitialSecurityStruct *request = reinterpret_cast <const ezspSetInitialSecurityStruct*> (data.constData());
+            m_networkKey = QByteArray(reinterpret_cast <const char*> (request->networkKey), sizeof(request->networkKey));
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00));
+            break;
+        }
+
+        case EZSP_FRAME_FORM_NERWORK:
+        {
+            memcpy(&m_network, data.constData(), sizeof(m_network));
+            m_joined = true;
+
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00));
+            sendFrame(0x00, 0x90, EZSP_FRAME_STACK_STATUS_HANDLER, QByteArray(1, static_cast <char> (EZSP_STACK_STATUS_NETWORK_UP)));
+            break;
+        }
+
+        case EZSP_FRAME_LEAVE_NETWORK:
+        {
+            m_joined = false;
+
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00));
+            sendFrame(0x00, 0x90, EZSP_FRAME_STACK_STATUS_HANDLER, QByteArray(1, static_cast <char> (EZSP_STACK_STATUS_NETWORK_DOWN)));
+            break;
+        }
+
+        case EZSP_FRAME_PERMIT_JOINING:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00));
+            setPermitJoin(data.at(0) ? true : false);
+            break;
+
+        case EZSP_FRAME_FIND_KEY_TABLE_ENTRY:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, static_cast <char> (0xFF)));
+            break;
+
+        case EZSP_FRAME_SET_SOURCE_ROUTE_DISCOVERY_MODE:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(4, 0x00));
+            break;
+
+        case EZSP_FRAME_SEND_UNICAST:
+        {
+            ezspMessageSentStruct message;
+
+            memcpy(&message, data.constData(), sizeof(ezspSendUnicastStruct) - 1);
+            message.length = 0;
+
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00).append(static_cast <char> (message.sequence)));
+
+            unicastRequest(qFromLittleEndian(message.networkAddress), message.dstEndpointId, qFromLittleEndian(message.clusterId), data.mid(sizeof(ezspSendUnicastStruct), static_cast <quint8> (data.at(sizeof(ezspSendUnicastStruct) - 1))), [this, message] (bool delivered) mutable
+            {
+                message.status = delivered ? 0x00 : EZSP_STATUS_DELIVERY_FAILED;
+                sendFrame(0x00, 0x90, EZSP_FRAME_MESSAGE_SENT_HANDLER, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)));
+            });
+
+            break;
+        }
+
+        case EZSP_FRAME_SEND_MULTICAST:
+        {
+            const ezspSendMulticastStruct *request = reinterpret_cast <const ezspSendMulticastStruct*> (data.constData());
+            ezspMessageSentStruct message;
+
+            memset(&message, 0, sizeof(message));
+
+            message.type = 0x03;
+            message.profileId = request->profileId;
+            message.clusterId = request->clusterId;
+            message.srcEndpointId = request->srcEndpointId;
+            message.dstEndpointId = request->dstEndpointId;
+            message.options = request->options;
+            message.groupId = request->groupId;
+            message.sequence = request->sequence;
+            message.tag = request->tag;
+
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00).append(static_cast <char> (message.sequence)));
+
+            multicastRequest([this, message] (bool)
+            {
+                sendFrame(0x00, 0x90, EZSP_FRAME_MESSAGE_SENT_HANDLER, QByteArray(reinterpret_cast <const char*> (&message), sizeof(message)));
+            });
+
+            break;
+        }
+
+        default:
+            sendFrame(header->sequence, 0x80, frameId, QByteArray(1, 0x00));
+            break;
+    }
+}
+
+void EZSPSimulator::incomingMessage(const VirtualDevice &device, quint16 profileId, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    ezspIncomingMessageStruct message;
+
+    memset(&message, 0, sizeof(message));
+
+    message.type = EZSP_MESSAGE_TYPE_DIRECT;
+    message.profileId = qToLittleEndian(profileId);
+    message.clusterId = qToLittleEndian(clusterId);
+    message.srcEndpointId = endpointId;
+    message.dstEndpointId = endpointId ? 0x01 : 0x00;
+    message.linkQuality = 0xFF;
+    message.rssi = 0xC8;
+    message.networkAddress = qToLittleEndian(device->networkAddress());
+    message.bindingIndex = 0xFF;
+    message.addressIndex = 0xFF;
+    message.length = static_cast <quint8> (payload.length());
+
+    sendFrame(0x00, 0x90, EZSP_FRAME_INCOMING_MESSAGE_HANDLER, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)).append(payload));
+}
+
+void EZSPSimulator::reset(void)
+{
+    m_sequenceId = 0;
+    m_acknowledgeId = 0;
+    m_reject = false;
+}
+
+int EZSPSimulator::parseData(const QByteArray &buffer)
+{
+    int offset = 0;
+
+    while (offset < buffer.length())
+    {
+        int length = buffer.indexOf(static_cast <char> (ASH_PACKET_FLAG), offset) - offset;
+        QByteArray packet;
+        quint16 crc;
+        quint8 control;
+
+        if (length < 0)
+            break;
+
+        for (int i = offset; i < offset + length; i++)
+        {
+            switch (buffer.at(i))
+            {
+                case 0x11:
+                case 0x13:
+                    break;
+
+                case 0x1A:
+                    packet.clear();
+                    break;
+
+                case 0x7D:
+                    packet.append(static_cast <char> (buffer.at(++i) ^ 0x20));
+                    break;
+
+                default:
+                    packet.append(buffer.at(i));
+                    break;
+            }
+        }
+
+        offset += length + 1;
+
+        if (packet.length() < 3)
+            continue;
+
+        memcpy(&crc, packet.constData() + packet.length() - 2, sizeof(crc));
+
+        if (crc != getCRC(reinterpret_cast <const quint8*> (packet.constData()), packet.length() - 2))
+        {
+            logWarning << "Packet" << packet.toHex(':') << "CRC mismatch";
+            continue;
+        }
+
+        control = static_cast <quint8> (packet.at(0));
+
+        if (control == ASH_CONTROL_RST)
+        {
+            reset();
+            sendRequest(ASH_CONTROL_RSTACK, QByteArray::fromHex("020b"));
+            continue;
+        }
+
+        if (!(control & 0x80))
+        {
+            QByteArray payload = packet.mid(1, packet.length() - 3);
+            quint8 frameId = (control >> 4) & 0x07;
+
+            if (frameId != m_acknowledgeId)
+            {
+                if (control & 0x08 && frameId == ((m_acknowledgeId - 1) & 0x07))
+                {
+                    sendRequest(ASH_CONTROL_ACK | m_acknowledgeId);
+                    continue;
+                }
+
+                if (!m_reject)
+                {
+                    sendRequest(ASH_CONTROL_NAK | m_acknowledgeId);
+                    m_reject = true;
+                }
+
+                continue;
+            }
+
+            m_reject = false;
+            m_acknowledgeId = (frameId + 1) & 0x07;
+            sendRequest(ASH_CONTROL_ACK | m_acknowledgeId);
+
+            randomize(payload);
+            parsePacket(payload);
+        }
+    }
+
+    return offset;
+}
+
+void EZSPSimulator::deviceAnnounce(const VirtualDevice &device)
+{
+    deviceAnnounceStruct announce;
+
+    announce.networkAddress = qToLittleEndian(device->networkAddress());
+    announce.ieeeAddress = qToLittleEndian(device->ieeeAddress());
+    announce.capabilities = 0x80;
+
+    incomingMessage(device, 0x0000, 0x00, ZDO_DEVICE_ANNOUNCE, QByteArray(1, 0x00).append(reinterpret_cast <char*> (&announce), sizeof(announce)));
+}
+
+void EZSPSimulator::zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    incomingMessage(device, PROFILE_HA, endpointId, clusterId, payload);
+}
+
+void EZSPSimulator::zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload)
+{
+    incomingMessage(device, 0x0000, 0x00, clusterId, QByteArray(1, static_cast <char> (transactionId)).append(payload));
+}
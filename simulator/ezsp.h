@@ -0,0 +1,45 @@
+#ifndef SIMULATOR_EZSP_H
+#define SIMULATOR_EZSP_H
+
+#define EZSP_SIMULATOR_VERSION          8
+#define EZSP_STATUS_DELIVERY_FAILED     0x66
+#define EZSP_STATUS_NOT_JOINED          0x93
+
+#include "../ezsp.h"
+#include "simulator.h"
+
+class EZSPSimulator : public Simulator
+{
+    Q_OBJECT
+
+public:
+
+    EZSPSimulator(QSettings *config, QObject *parent);
+
+private:
+
+    quint8 m_sequenceId, m_acknowledgeId;
+    bool m_reject, m_joined;
+
+    ezspNetworkParametersStruct m_network;
+
+    quint16 getCRC(const quint8 *data, quint32 length);
+    void randomize(QByteArray &data);
+
+    void sendRequest(quint8 control, const QByteArray &payload = QByteArray());
+    void sendFrame(quint8 sequence, quint8 frameControl, quint16 frameId, const QByteArray &data = QByteArray());
+    void sendPayload(QByteArray payload);
+    void parsePacket(const QByteArray &payload);
+
+    void incomingMessage(const VirtualDevice &device, quint16 profileId, quint8 endpointId, quint16 clusterId, const QByteArray &payload);
+
+    void reset(void) override;
+    int parseData(const QByteArray &buffer) override;
+
+    void deviceAnnounce(const VirtualDevice &device) override;
+    void zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload) override;
+    void zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload) override;
+
+};
+
+#endif
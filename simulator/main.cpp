@@ -0,0 +1,38 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include "ezsp.h"
+#include "logger.h"
+#include "zboss.h"
+#include "zigate.h"
+#include "zstack.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCommandLineParser parser;
+    QList <QString> list = {"ezsp", "zboss", "zigate", "znp"};
+    QSettings *config;
+    QString adapterType;
+    Simulator *simulator;
+
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption({"c", "config"}, "Configuration file path.", "file", "/etc/homed/homed-zigbee.conf"));
+    parser.process(application);
+
+    config = new QSettings(parser.value("config"), QSettings::IniFormat, &application);
+    adapterType = config->value("zigbee/adapter", "znp").toString();
+
+    switch (list.indexOf(adapterType))
+    {
+        case 0:  simulator = new EZSPSimulator(config, &application); break;
+        case 1:  simulator = new ZBossSimulator(config, &application); break;
+        case 2:  simulator = new ZiGateSimulator(config, &application); break;
+        case 3:  simulator = new ZStackSimulator(config, &application); break;
+        default: logWarning << "Unrecognized adapter type" << adapterType; return 1;
+    }
+
+    if (!simulator->start())
+        return 1;
+
+    return application.exec();
+}
@@ -0,0 +1,442 @@
+#include <QtEndian>
+#include <QRandomGenerator>
+#include "adapter.h"
+#include "logger.h"
+#include "simulator.h"
+#include "zcl.h"
+
+static const QList <quint16> inClusters = {CLUSTER_BASIC, CLUSTER_POWER_CONFIGURATION, CLUSTER_IDENTIFY, CLUSTER_TEMPERATURE_MEASUREMENT, CLUSTER_HUMIDITY_MEASUREMENT};
+static const QList <quint16> outClusters = {CLUSTER_IDENTIFY};
+
+static QByteArray stringValue(const QString &value)
+{
+    return QByteArray(1, static_cast <char> (DATA_TYPE_CHARACTER_STRING)).append(static_cast <char> (value.length())).append(value.toUtf8());
+}
+
+static QByteArray numericValue(quint8 dataType, qint32 value, quint8 size)
+{
+    value = qToLittleEndian(value);
+    return QByteArray(1, static_cast <char> (dataType)).append(reinterpret_cast <char*> (&value), size);
+}
+
+Simulator::Simulator(QSettings *config, QObject *parent) : QObject(parent), m_server(new QTcpServer(this)), m_socket(nullptr), m_reportTimer(new QTimer(this)), m_statisticsTimer(new QTimer(this)), m_requests(0), m_lost(0), m_responses(0), m_reports(0)
+{
+    QList <QString> list = config->value("zigbee/port", "tcp://127.0.0.1:8888").toString().remove("tcp://").split(":");
+    int count = config->value("simulator/devices", 10).toInt();
+    bool joined = config->value("simulator/joined", false).toBool();
+
+    m_address = QHostAddress(list.value(0));
+    m_port = static_cast <quint16> (list.value(1).toInt());
+
+    m_panId = static_cast <quint16> (config->value("zigbee/panid", "0x1010").toString().toInt(nullptr, 16));
+    m_channel = static_cast <quint8> (config->value("zigbee/channel", 11).toInt());
+    m_networkKey = QByteArray::fromHex(config->value("security/key", "000102030405060708090a0b0c0d0e0f").toString().remove("0x").toUtf8());
+    m_ieeeAddress = SIMULATOR_DEVICE_ADDRESS | 0xFFFF;
+    m_debug = config->value("simulator/debug", false).toBool();
+
+    m_latency = config->value("simulator/latency", 20).toInt();
+    m_jitter = config->value("simulator/jitter", 10).toInt();
+    m_loss = config->value("simulator/loss", 0).toInt();
+    m_interval = config->value("simulator/interval", 60).toInt();
+
+    if (m_channel < 11 || m_channel > 26)
+        m_channel = 11;
+
+    for (int i = 0; i < count; i++)
+    {
+        VirtualDevice device(new VirtualDeviceObject(SIMULATOR_DEVICE_ADDRESS | i, static_cast <quint16> (SIMULATOR_NETWORK_ADDRESS + i)));
+
+        device->attributes().insert(CLUSTER_BASIC << 16 | 0x0001, numericValue(DATA_TYPE_8BIT_UNSIGNED, 0x01, 1));
+        device->attributes().insert(CLUSTER_BASIC << 16 | 0x0004, stringValue("eWeLink"));
+        device->attributes().insert(CLUSTER_BASIC << 16 | 0x0005, stringValue("TH01"));
+        device->attributes().insert(CLUSTER_BASIC << 16 | 0x0007, numericValue(DATA_TYPE_8BIT_ENUM, 0x03, 1));
+        device->attributes().insert(CLUSTER_BASIC << 16 | 0x4000, stringValue("simulator"));
+        device->attributes().insert(CLUSTER_POWER_CONFIGURATION << 16 | 0x0021, numericValue(DATA_TYPE_8BIT_UNSIGNED, 200, 1));
+        device->attributes().insert(CLUSTER_TEMPERATURE_MEASUREMENT << 16 | 0x0000, numericValue(DATA_TYPE_16BIT_SIGNED, 2150, 2));
+        device->attributes().insert(CLUSTER_HUMIDITY_MEASUREMENT << 16 | 0x0000, numericValue(DATA_TYPE_16BIT_UNSIGNED, 4500, 2));
+
+        device->setJoined(joined);
+        m_devices.insert(device->networkAddress(), device);
+    }
+
+    connect(m_server, &QTcpServer::newConnection, this, &Simulator::newConnection);
+    connect(m_reportTimer, &QTimer::timeout, this, &Simulator::reportTimeout);
+    connect(m_statisticsTimer, &QTimer::timeout, this, &Simulator::statisticsTimeout);
+}
+
+bool Simulator::start(void)
+{
+    if (!m_server->listen(m_address, m_port))
+    {
+        logWarning << "Listen on" << QString("%1:%2").arg(m_address.toString()).arg(m_port) << "failed:" << m_server->errorString();
+        return false;
+    }
+
+    logInfo << "Simulating" << m_devices.count() << "devices on" << QString("%1:%2").arg(m_address.toString()).arg(m_port) << "with latency" << m_latency << "ms, jitter" << m_jitter << "ms and loss" << m_loss << "%";
+
+    if (m_interval > 0)
+        m_reportTimer->start(m_interval * 1000);
+
+    m_statisticsTimer->start(SIMULATOR_STATISTICS_INTERVAL);
+    return true;
+}
+
+void Simulator::sendData(const QByteArray &buffer)
+{
+    if (!m_socket)
+        return;
+
+    logDebug(m_debug) << "Data sent:" << buffer.toHex(':');
+
+    m_socket->write(buffer);
+}
+
+void Simulator::setPermitJoin(bool enabled)
+{
+    int count = 0;
+
+    if (!enabled)
+        return;
+
+    for (auto it = m_devices.begin(); it != m_devices.end(); it++)
+    {
+        VirtualDevice device = it.value();
+
+        if (device->joined())
+            continue;
+
+        QTimer::singleShot(++count * SIMULATOR_JOIN_INTERVAL, this, [this, device] () { device->setJoined(true); deviceAnnounce(device); });
+    }
+}
+
+VirtualDevice Simulator::findDevice(quint64 ieeeAddress)
+{
+    for (auto it = m_devices.begin(); it != m_devices.end(); it++)
+        if (it.value()->ieeeAddress() == ieeeAddress)
+            return it.value();
+
+    return VirtualDevice();
+}
+
+void Simulator::unicastRequest(quint16 networkAddress, quint8 endpointId, quint16 clusterId, const QByteArray &payload, const Confirm &confirm)
+{
+    VirtualDevice device = m_devices.value(networkAddress);
+    bool delivered = !device.isNull() && !lost();
+
+    m_requests++;
+
+    QTimer::singleShot(delay(), this, [this, device, endpointId, clusterId, payload, confirm, delivered] ()
+    {
+        confirm(delivered);
+
+        if (!delivered)
+            return;
+
+        if (!endpointId)
+        {
+            zdoResponse(device, clusterId, static_cast <quint8> (payload.at(0)), payload.mid(1));
+            return;
+        }
+
+        zclRequest(device, endpointId, clusterId, payload);
+    });
+}
+
+void Simulator::multicastRequest(const Confirm &confirm)
+{
+    m_requests++;
+    QTimer::singleShot(delay(), this, [confirm] () { confirm(true); });
+}
+
+void Simulator::zdoRequest(quint16 networkAddress, quint16 clusterId, quint8 transactionId, const QByteArray &data, const Confirm &confirm)
+{
+    VirtualDevice device = m_devices.value(networkAddress);
+    bool delivered = !device.isNull() && !lost();
+
+    m_requests++;
+
+    QTimer::singleShot(delay(), this, [this, device, clusterId, transactionId, data, confirm, delivered] ()
+    {
+        confirm(delivered);
+
+        if (!delivered)
+            return;
+
+        zdoResponse(device, clusterId, transactionId, data);
+    });
+}
+
+int Simulator::delay(void)
+{
+    return m_jitter > 0 ? m_latency + QRandomGenerator::global()->bounded(m_jitter) : m_latency;
+}
+
+bool Simulator::lost(void)
+{
+    if (m_loss <= 0 || QRandomGenerator::global()->bounded(100) >= m_loss)
+        return false;
+
+    m_lost++;
+    return true;
+}
+
+void Simulator::zclRequest(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    quint8 frameControl = static_cast <quint8> (payload.at(0)), offset = frameControl & FC_MANUFACTURER_SPECIFIC ? 3 : 1, transactionId, commandId;
+    quint16 manufacturerCode = 0;
+    QByteArray data, response;
+
+    if (payload.length() < offset + 2)
+        return;
+
+    if (frameControl & FC_MANUFACTURER_SPECIFIC)
+    {
+        memcpy(&manufacturerCode, payload.constData() + 1, sizeof(manufacturerCode));
+        manufacturerCode = qFromLittleEndian(manufacturerCode);
+    }
+
+    transactionId = static_cast <quint8> (payload.at(offset));
+    commandId = static_cast <quint8> (payload.at(offset + 1));
+    data = payload.mid(offset + 2);
+
+    if (!(frameControl & FC_CLUSTER_SPECIFIC))
+    {
+        switch (commandId)
+        {
+            case CMD_READ_ATTRIBUTES:
+            {
+                for (int i = 0; i + 1 < data.length(); i += 2)
+                {
+                    quint16 attributeId;
+                    QByteArray value;
+
+                    memcpy(&attributeId, data.constData() + i, sizeof(attributeId));
+                    value = device->attributes().value(clusterId << 16 | qFromLittleEndian(attributeId));
+
+                    response.append(data.mid(i, sizeof(attributeId)));
+                    response.append(1, static_cast <char> (value.isEmpty() ? STATUS_UNSUPPORTED_ATTRIBUTE : STATUS_SUCCESS));
+                    response.append(value);
+                }
+
+                zclResponse(device, endpointId, clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_READ_ATTRIBUTES_RESPONSE, manufacturerCode).append(response));
+                return;
+            }
+
+            case CMD_WRITE_ATTRIBUTES:
+                zclResponse(device, endpointId, clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_WRITE_ATTRIBUTES_RESPONSE, manufacturerCode).append(1, STATUS_SUCCESS));
+                return;
+
+            case CMD_CONFIGURE_REPORTING:
+                zclResponse(device, endpointId, clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_CONFIGURE_REPORTING_RESPONSE, manufacturerCode).append(1, STATUS_SUCCESS));
+                return;
+        }
+    }
+
+    if (frameControl & FC_DISABLE_DEFAULT_RESPONSE)
+        return;
+
+    zclResponse(device, endpointId, clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_DEFAULT_RESPONSE, manufacturerCode).append(static_cast <char> (commandId)).append(1, STATUS_SUCCESS));
+}
+
+void Simulator::zdoResponse(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &data)
+{
+    quint16 networkAddress = qToLittleEndian(device->networkAddress());
+    QByteArray payload;
+
+    switch (clusterId)
+    {
+        case ZDO_NODE_DESCRIPTOR_REQUEST:
+        {
+            nodeDescriptorResponseStruct response;
+
+            response.status = 0x00;
+            response.networkAddress = networkAddress;
+            response.logicalType = static_cast <quint8> (LogicalType::EndDevice);
+            response.apsFlags = 0x40;
+            response.capabilityFlags = 0x80;
+            response.manufacturerCode = 0x0000;
+            response.maxBufferSize = 0x50;
+            response.maxTransferSize = qToLittleEndian <quint16> (0x00A0);
+            response.serverFlags = qToLittleEndian <quint16> (0x2C00);
+            response.maxOutTransferSize = qToLittleEndian <quint16> (0x00A0);
+            response.descriptorCapabilities = 0x00;
+
+            payload.append(reinterpret_cast <char*> (&response), sizeof(response));
+            break;
+        }
+
+        case ZDO_SIMPLE_DESCRIPTOR_REQUEST:
+        {
+            simpleDescriptorResponseStruct response;
+
+            if (data.length() < 3 || data.at(2) != 0x01)
+            {
+                payload.append(1, static_cast <char> (0x83)).append(reinterpret_cast <char*> (&networkAddress), sizeof(networkAddress)).append(1, 0x00);
+                break;
+            }
+
+            response.status = 0x00;
+            response.networkAddress = networkAddress;
+            response.length = static_cast <quint8> (sizeof(response) - 4 + 2 + inClusters.count() * 2 + outClusters.count() * 2);
+            response.endpointId = 0x01;
+            response.profileId = qToLittleEndian <quint16> (PROFILE_HA);
+            response.deviceId = qToLittleEndian <quint16> (0x0302);
+            response.version = 0x00;
+
+            payload.append(reinterpret_cast <char*> (&response), sizeof(response));
+            payload.append(static_cast <char> (inClusters.count()));
+
+            for (int i = 0; i < inClusters.count(); i++)
+            {
+                quint16 value = qToLittleEndian(inClusters.at(i));
+                payload.append(reinterpret_cast <char*> (&value), sizeof(value));
+            }
+
+            payload.append(static_cast <char> (outClusters.count()));
+
+            for (int i = 0; i < outClusters.count(); i++)
+            {
+                quint16 value = qToLittleEndian(outClusters.at(i));
+                payload.append(reinterpret_cast <char*> (&value), sizeof(value));
+            }
+
+            break;
+        }
+
+        case ZDO_ACTIVE_ENDPOINTS_REQUEST:
+        {
+            activeEndpointsResponseStruct response;
+
+            response.status = 0x00;
+            response.networkAddress = networkAddress;
+            response.count = 0x01;
+
+            payload.append(reinterpret_cast <char*> (&response), sizeof(response)).append(1, 0x01);
+            break;
+        }
+
+        case ZDO_LQI_REQUEST:
+        {
+            lqiResponseStruct response;
+
+            response.status = 0x00;
+            response.total = 0x00;
+            response.index = static_cast <quint8> (data.at(0));
+            response.count = 0x00;
+
+            payload.append(reinterpret_cast <char*> (&response), sizeof(response));
+            break;
+        }
+
+        case ZDO_LEAVE_REQUEST:
+            device->setJoined(false);
+            payload.append(1, 0x00);
+            break;
+
+        default:
+            payload.append(1, 0x00);
+            break;
+    }
+
+    QTimer::singleShot(delay(), this, [this, device, clusterId, transactionId, payload] ()
+    {
+        if (lost())
+            return;
+
+        m_responses++;
+        zdoMessage(device, clusterId | 0x8000, transactionId, payload);
+    });
+}
+
+void Simulator::zclResponse(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    QTimer::singleShot(delay(), this, [this, device, endpointId, clusterId, payload] ()
+    {
+        if (lost())
+            return;
+
+        m_responses++;
+        zclMessage(device, endpointId, clusterId, payload);
+    });
+}
+
+void Simulator::newConnection(void)
+{
+    QTcpSocket *socket = m_server->nextPendingConnection();
+
+    if (m_socket)
+    {
+        logWarning << "Replacing active connection from" << m_socket->peerAddress().toString();
+        m_socket->disconnect(this);
+        m_socket->deleteLater();
+    }
+
+    logInfo << "Adapter connected from" << socket->peerAddress().toString();
+
+    m_socket = socket;
+    m_buffer.clear();
+    reset();
+
+    connect(m_socket, &QTcpSocket::disconnected, this, &Simulator::disconnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &Simulator::readyRead);
+}
+
+void Simulator::disconnected(void)
+{
+    logInfo << "Adapter disconnected";
+    m_socket->deleteLater();
+    m_socket = nullptr;
+}
+
+void Simulator::readyRead(void)
+{
+    QByteArray buffer = m_socket->readAll();
+
+    logDebug(m_debug) << "Data received:" << buffer.toHex(':');
+
+    m_buffer.append(buffer);
+    m_buffer.remove(0, parseData(m_buffer));
+}
+
+void Simulator::reportTimeout(void)
+{
+    int interval = m_interval * 1000;
+
+    for (auto it = m_devices.begin(); it != m_devices.end(); it++)
+    {
+        VirtualDevice device = it.value();
+
+        if (!device->joined())
+            continue;
+
+        QTimer::singleShot(QRandomGenerator::global()->bounded(interval), this, [this, device] ()
+        {
+            QByteArray temperature = numericValue(DATA_TYPE_16BIT_SIGNED, 2000 + QRandomGenerator::global()->bounded(500), 2), humidity = numericValue(DATA_TYPE_16BIT_UNSIGNED, 4000 + QRandomGenerator::global()->bounded(2000), 2);
+
+            device->attributes().insert(CLUSTER_TEMPERATURE_MEASUREMENT << 16 | 0x0000, temperature);
+            device->attributes().insert(CLUSTER_HUMIDITY_MEASUREMENT << 16 | 0x0000, humidity);
+
+            if (!m_socket || lost())
+                return;
+
+            m_reports += 2;
+            zclMessage(device, 0x01, CLUSTER_TEMPERATURE_MEASUREMENT, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, device->transactionId(), CMD_REPORT_ATTRIBUTES).append(2, 0x00).append(temperature));
+            zclMessage(device, 0x01, CLUSTER_HUMIDITY_MEASUREMENT, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, device->transactionId(), CMD_REPORT_ATTRIBUTES).append(2, 0x00).append(humidity));
+        });
+    }
+}
+
+void Simulator::statisticsTimeout(void)
+{
+    qreal interval = SIMULATOR_STATISTICS_INTERVAL / 1000.0;
+
+    if (!m_requests && !m_reports)
+        return;
+
+    logInfo << QString::asprintf("Requests: %u (%.1f/s), lost: %u, responses: %u (%.1f/s), reports: %u", m_requests, m_requests / interval, m_lost, m_responses, m_responses / interval, m_reports).toUtf8().constData();
+
+    m_requests = 0;
+    m_lost = 0;
+    m_responses = 0;
+    m_reports = 0;
+}
@@ -0,0 +1,117 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#define SIMULATOR_DEVICE_ADDRESS        0x00124B0000000000
+#define SIMULATOR_NETWORK_ADDRESS       0x1000
+#define SIMULATOR_JOIN_INTERVAL         100
+#define SIMULATOR_STATISTICS_INTERVAL   10000
+
+#include <functional>
+#include <QSettings>
+#include <QSharedPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+typedef std::function <void (bool delivered)> Confirm;
+
+class VirtualDeviceObject;
+typedef QSharedPointer <VirtualDeviceObject> VirtualDevice;
+
+class VirtualDeviceObject
+{
+
+public:
+
+    VirtualDeviceObject(quint64 ieeeAddress, quint16 networkAddress) :
+        m_ieeeAddress(ieeeAddress), m_networkAddress(networkAddress), m_transactionId(0), m_joined(false) {}
+
+    inline quint64 ieeeAddress(void) { return m_ieeeAddress; }
+    inline quint16 networkAddress(void) { return m_networkAddress; }
+
+    inline quint8 transactionId(void) { return m_transactionId++; }
+
+    inline bool joined(void) { return m_joined; }
+    inline void setJoined(bool value) { m_joined = value; }
+
+    inline QMap <quint32, QByteArray> &attributes(void) { return m_attributes; }
+
+private:
+
+    quint64 m_ieeeAddress;
+    quint16 m_networkAddress;
+    quint8 m_transactionId;
+    bool m_joined;
+
+    QMap <quint32, QByteArray> m_attributes;
+
+};
+
+class Simulator : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Simulator(QSettings *config, QObject *parent);
+
+    bool start(void);
+
+protected:
+
+    quint16 m_panId;
+    quint8 m_channel;
+    QByteArray m_networkKey;
+    quint64 m_ieeeAddress;
+    bool m_debug;
+
+    void sendData(const QByteArray &buffer);
+
+    void setPermitJoin(bool enabled);
+    VirtualDevice findDevice(quint64 ieeeAddress);
+
+    void unicastRequest(quint16 networkAddress, quint8 endpointId, quint16 clusterId, const QByteArray &payload, const Confirm &confirm);
+    void multicastRequest(const Confirm &confirm);
+    void zdoRequest(quint16 networkAddress, quint16 clusterId, quint8 transactionId, const QByteArray &data, const Confirm &confirm);
+
+private:
+
+    QTcpServer *m_server;
+    QTcpSocket *m_socket;
+    QTimer *m_reportTimer, *m_statisticsTimer;
+
+    QHostAddress m_address;
+    quint16 m_port;
+
+    int m_latency, m_jitter, m_loss, m_interval;
+    QMap <quint16, VirtualDevice> m_devices;
+    QByteArray m_buffer;
+
+    quint32 m_requests, m_lost, m_responses, m_reports;
+
+    int delay(void);
+    bool lost(void);
+
+    void zclRequest(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload);
+    void zdoResponse(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &data);
+    void zclResponse(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload);
+
+    virtual void reset(void) = 0;
+    virtual int parseData(const QByteArray &buffer) = 0;
+
+    virtual void deviceAnnounce(const VirtualDevice &device) = 0;
+    virtual void zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload) = 0;
+    virtual void zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload) = 0;
+
+private slots:
+
+    void newConnection(void);
+    void disconnected(void);
+    void readyRead(void);
+
+    void reportTimeout(void);
+    void statisticsTimeout(void);
+
+};
+
+#endif
@@ -0,0 +1,24 @@
+QT += network serialport
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = homed-zigbee-simulator
+INCLUDEPATH += .. ../../homed-common
+
+HEADERS += \
+    ezsp.h \
+    simulator.h \
+    zboss.h \
+    zigate.h \
+    zstack.h
+
+SOURCES += \
+    ../zcl.cpp \
+    ezsp.cpp \
+    main.cpp \
+    simulator.cpp \
+    zboss.cpp \
+    zigate.cpp \
+    zstack.cpp
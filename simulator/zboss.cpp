@@ -0,0 +1,361 @@
+#include <QtEndian>
+#include "zboss.h"
+#include "logger.h"
+
+static uint8_t const crc8Table[256] =
+{
+    0xea, 0xd4, 0x96, 0xa8, 0x12, 0x2c, 0x6e, 0x50, 0x7f, 0x41, 0x03, 0x3d, 0x87, 0xb9, 0xfb, 0xc5,
+    0xa5, 0x9b, 0xd9, 0xe7, 0x5d, 0x63, 0x21, 0x1f, 0x30, 0x0e, 0x4c, 0x72, 0xc8, 0xf6, 0xb4, 0x8a,
+    0x74, 0x4a, 0x08, 0x36, 0x8c, 0xb2, 0xf0, 0xce, 0xe1, 0xdf, 0x9d, 0xa3, 0x19, 0x27, 0x65, 0x5b,
+    0x3b, 0x05, 0x47, 0x79, 0xc3, 0xfd, 0xbf, 0x81, 0xae, 0x90, 0xd2, 0xec, 0x56, 0x68, 0x2a, 0x14,
+    0xb3, 0x8d, 0xcf, 0xf1, 0x4b, 0x75, 0x37, 0x09, 0x26, 0x18, 0x5a, 0x64, 0xde, 0xe0, 0xa2, 0x9c,
+    0xfc, 0xc2, 0x80, 0xbe, 0x04, 0x3a, 0x78, 0x46, 0x69, 0x57, 0x15, 0x2b, 0x91, 0xaf, 0xed, 0xd3,
+    0x2d, 0x13, 0x51, 0x6f, 0xd5, 0xeb, 0xa9, 0x97, 0xb8, 0x86, 0xc4, 0xfa, 0x40, 0x7e, 0x3c, 0x02,
+    0x62, 0x5c, 0x1e, 0x20, 0x9a, 0xa4, 0xe6, 0xd8, 0xf7, 0xc9, 0x8b, 0xb5, 0x0f, 0x31, 0x73, 0x4d,
+    0x58, 0x66, 0x24, 0x1a, 0xa0, 0x9e, 0xdc, 0xe2, 0xcd, 0xf3, 0xb1, 0x8f, 0x35, 0x0b, 0x49, 0x77,
+    0x17, 0x29, 0x6b, 0x55, 0xef, 0xd1, 0x93, 0xad, 0x82, 0xbc, 0xfe, 0xc0, 0x7a, 0x44, 0x06, 0x38,
+    0xc6, 0xf8, 0xba, 0x84, 0x3e, 0x00, 0x42, 0x7c, 0x53, 0x6d, 0x2f, 0x11, 0xab, 0x95, 0xd7, 0xe9,
+    0x89, 0xb7, 0xf5, 0xcb, 0x71, 0x4f, 0x0d, 0x33, 0x1c, 0x22, 0x60, 0x5e, 0xe4, 0xda, 0x98, 0xa6,
+    0x01, 0x3f, 0x7d, 0x43, 0xf9, 0xc7, 0x85, 0xbb, 0x94, 0xaa, 0xe8, 0xd6, 0x6c, 0x52, 0x10, 0x2e,
+    0x4e, 0x70, 0x32, 0x0c, 0xb6, 0x88, 0xca, 0xf4, 0xdb, 0xe5, 0xa7, 0x99, 0x23, 0x1d, 0x5f, 0x61,
+    0x9f, 0xa1, 0xe3, 0xdd, 0x67, 0x59, 0x1b, 0x25, 0x0a, 0x34, 0x76, 0x48, 0xf2, 0xcc, 0x8e, 0xb0,
+    0xd0, 0xee, 0xac, 0x92, 0x28, 0x16, 0x54, 0x6a, 0x45, 0x7b, 0x39, 0x07, 0xbd, 0x83, 0xc1, 0xff
+};
+
+quint8 ZBossSimulator::getCRC8(const quint8 *data, quint32 length)
+{
+    quint8 crc = 0x00;
+
+    while (length--)
+        crc = crc8Table[crc ^ *data++];
+
+    return crc;
+}
+
+quint16 ZBossSimulator::getCRC16(const quint8 *data, quint32 length)
+{
+    quint16 crc = 0x0000;
+
+    while (length--)
+    {
+        crc ^= *data++;
+
+        for (quint8 i = 0; i < 8; i++)
+            crc = crc & 0x0001 ? (crc >> 1) ^ 0x8408 : crc >> 1;
+    }
+
+    return qToLittleEndian(crc);
+}
+
+void ZBossSimulator::sendFrame(quint8 flags, const QByteArray &payload)
+{
+    zbossLowLevelHeaderStruct lowLevelHeader;
+    QByteArray frame;
+
+    lowLevelHeader.signature = qToBigEndian <quint16> (ZBOSS_SIGNATURE);
+    lowLevelHeader.length = qToLittleEndian <quint16> (payload.isEmpty() ? 5 : payload.length() + 7);
+    lowLevelHeader.type = ZBOSS_NCP_API_HL;
+    lowLevelHeader.flags = flags;
+    lowLevelHeader.crc = getCRC8(reinterpret_cast <quint8*> (&lowLevelHeader) + 2, sizeof(lowLevelHeader) - 3);
+
+    frame.append(reinterpret_cast <char*> (&lowLevelHeader), sizeof(lowLevelHeader));
+
+    if (!payload.isEmpty())
+    {
+        quint16 crc = getCRC16(reinterpret_cast <const quint8*> (payload.constData()), payload.length());
+        frame.append(reinterpret_cast <char*> (&crc), sizeof(crc)).append(payload);
+    }
+
+    sendData(frame);
+}
+
+void ZBossSimulator::sendPacket(quint8 type, quint16 command, const QByteArray &data)
+{
+    zbossCommonHeaderStruct header;
+
+    header.version = ZBOSS_PROTOCOL_VERSION;
+    header.type = type;
+    header.id = qToLittleEndian(command);
+
+    sendFrame(m_sequenceId << 2 | ZBOSS_FLAG_FIRST_FRAGMENT | ZBISS_FLAG_LAST_FRAGMENT, QByteArray(reinterpret_cast <char*> (&header), sizeof(header)).append(data));
+    m_sequenceId = (m_sequenceId + 1) & 0x03;
+}
+
+void ZBossSimulator::sendResponse(quint16 command, quint8 transactionId, quint8 status, const QByteArray &data)
+{
+    sendPacket(ZBOSS_TYPE_RESPONSE, command, QByteArray(1, static_cast <char> (transactionId)).append(1, 0x00).append(static_cast <char> (status)).append(data));
+}
+
+void ZBossSimulator::parsePacket(quint8 type, quint16 command, const QByteArray &data)
+{
+    quint8 transactionId = static_cast <quint8> (data.at(0));
+    QByteArray request = data.mid(1);
+
+    if (type != ZBOSS_TYPE_REQUEST)
+        return;
+
+    switch (command)
+    {
+        case ZBOSS_NCP_RESET:
+        {
+            m_sequenceId = 0;
+            sendPacket(ZBOSS_TYPE_INDICATION, ZBOSS_NCP_RESET_IND, QByteArray(1, 0x00));
+            break;
+        }
+
+        case ZBOSS_GET_MODULE_VERSION:
+        {
+            sendResponse(command, transactionId, 0x00, QByteArray::fromHex("0000010401000300000c0001"));
+            break;
+        }
+
+        case ZBOSS_GET_LOCAL_IEEE_ADDR:
+        {
+            quint64 ieeeAddress = qToLittleEndian(m_ieeeAddress);
+            sendResponse(command, transactionId, 0x00, QByteArray(1, 0x00).append(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)));
+            break;
+        }
+
+        case ZBOSS_GET_ZIGBEE_ROLE:
+        {
+            sendResponse(command, transactionId, 0x00, QByteArray(1, static_cast <char> (LogicalType::Coordinator)));
+            break;
+        }
+
+        case ZBOSS_GET_ZIGBEE_CHANNEL_MASK:
+        {
+            quint32 channelMask = qToLittleEndian <quint32> (1 << m_channel);
+            sendResponse(command, transactionId, 0x00, QByteArray(1, 0x01).append(1, 0x00).append(reinterpret_cast <char*> (&channelMask), sizeof(channelMask)));
+            break;
+        }
+
+        case ZBOSS_GET_PAN_ID:
+        {
+            quint16 panId = qToLittleEndian(m_panId);
+            sendResponse(command, transactionId, 0x00, QByteArray(reinterpret_cast <char*> (&panId), sizeof(panId)));
+            break;
+        }
+
+        case ZBOSS_GET_NWK_KEYS:
+        {
+            sendResponse(command, transactionId, 0x00, QByteArray(m_networkKey).append(1, 0x00));
+            break;
+        }
+
+        case ZBOSS_ZDO_PERMIT_JOINING_REQ:
+        {
+            const zbossPermitJoinStruct *permitJoin = reinterpret_cast <const zbossPermitJoinStruct*> (request.constData());
+            sendResponse(command, transactionId);
+            setPermitJoin(permitJoin->duration ? true : false);
+            break;
+        }
+
+        case ZBOSS_APSDE_DATA_REQ:
+        {
+            const zbossDataRequestStruct *dataRequest = reinterpret_cast <const zbossDataRequestStruct*> (request.constData());
+
+            if (dataRequest->addressMode == ADDRESS_MODE_GROUP)
+            {
+                multicastRequest([this, command, transactionId] (bool) { sendResponse(command, transactionId); });
+                break;
+            }
+
+            unicastRequest(static_cast <quint16> (qFromLittleEndian(dataRequest->dstAddress)), dataRequest->dstEndpointId, qFromLittleEndian(dataRequest->clusterId), request.mid(sizeof(zbossDataRequestStruct), qFromLittleEndian(dataRequest->dataLength)), [this, command, transactionId] (bool delivered)
+            {
+                sendResponse(command, transactionId, delivered ? 0x00 : ZBOSS_STATUS_APS_NO_ACK);
+            });
+
+            break;
+        }
+
+        case ZBOSS_ZDO_NODE_DESC_REQ:
+        case ZBOSS_ZDO_SIMPLE_DESC_REQ:
+        case ZBOSS_ZDO_ACTIVE_EP_REQ:
+        case ZBOSS_ZDO_BIND_REQ:
+        case ZBOSS_ZDO_UNBIND_REQ:
+        case ZBOSS_ZDO_MGMT_LEAVE_REQ:
+        case ZBOSS_ZDO_MGMT_LQI_REQ:
+        {
+            quint16 networkAddress, clusterId;
+            QByteArray payload;
+
+            memcpy(&networkAddress, request.constData(), sizeof(networkAddress));
+            networkAddress = qFromLittleEndian(networkAddress);
+
+            switch (command)
+            {
+                case ZBOSS_ZDO_NODE_DESC_REQ:   clusterId = ZDO_NODE_DESCRIPTOR_REQUEST; break;
+                case ZBOSS_ZDO_SIMPLE_DESC_REQ: clusterId = ZDO_SIMPLE_DESCRIPTOR_REQUEST; payload = request.mid(0, 3); break;
+                case ZBOSS_ZDO_ACTIVE_EP_REQ:   clusterId = ZDO_ACTIVE_ENDPOINTS_REQUEST; break;
+                case ZBOSS_ZDO_BIND_REQ:        clusterId = ZDO_BIND_REQUEST; break;
+                case ZBOSS_ZDO_UNBIND_REQ:      clusterId = ZDO_UNBIND_REQUEST; break;
+                case ZBOSS_ZDO_MGMT_LEAVE_REQ:  clusterId = ZDO_LEAVE_REQUEST; break;
+                default:                        clusterId = ZDO_LQI_REQUEST; payload = request.mid(2, 1); break;
+            }
+
+            zdoRequest(networkAddress, clusterId, transactionId, payload, [] (bool) {});
+            break;
+        }
+
+        default:
+        {
+            sendResponse(command, transactionId);
+            break;
+        }
+    }
+}
+
+void ZBossSimulator::reset(void)
+{
+    m_sequenceId = 0;
+}
+
+int ZBossSimulator::parseData(const QByteArray &buffer)
+{
+    int offset = 0;
+
+    while (offset < buffer.length())
+    {
+        int index = buffer.indexOf("\xDE\xAD", offset);
+        const zbossLowLevelHeaderStruct *lowLevelHeader;
+        const zbossCommonHeaderStruct *commonHeader;
+        const char *frame;
+        quint16 length;
+
+        if (index < 0)
+            return buffer.length() - 1;
+
+        offset = index;
+
+        if (buffer.length() - offset < static_cast <int> (sizeof(zbossLowLevelHeaderStruct)))
+            break;
+
+        frame = buffer.constData() + offset;
+        lowLevelHeader = reinterpret_cast <const zbossLowLevelHeaderStruct*> (frame);
+        length = qFromLittleEndian(lowLevelHeader->length) + 2;
+
+        if (lowLevelHeader->crc != getCRC8(reinterpret_cast <const quint8*> (frame) + 2, sizeof(zbossLowLevelHeaderStruct) - 3))
+        {
+            logWarning << "Frame" << buffer.mid(offset, sizeof(zbossLowLevelHeaderStruct)).toHex(':') << "low level header CRC mismatch";
+            offset++;
+            continue;
+        }
+
+        if (buffer.length() - offset < length)
+            break;
+
+        offset += length;
+
+        if (lowLevelHeader->flags & ZBOSS_FLAG_ACK)
+            continue;
+
+        sendFrame(ZBOSS_FLAG_ACK | (lowLevelHeader->flags >> 2 & 0x03) << 4);
+
+        if (length < 9 + sizeof(zbossCommonHeaderStruct) + 1)
+            continue;
+
+        if (*(reinterpret_cast <const quint16*> (frame + 7)) != getCRC16(reinterpret_cast <const quint8*> (frame + 9), length - 9))
+        {
+            logWarning << "Packet" << QByteArray(frame, length).toHex(':') << "CRC mismatch";
+            continue;
+        }
+
+        commonHeader = reinterpret_cast <const zbossCommonHeaderStruct*> (frame + 9);
+        parsePacket(commonHeader->type, qFromLittleEndian(commonHeader->id), QByteArray(frame + 9 + sizeof(zbossCommonHeaderStruct), length - 9 - sizeof(zbossCommonHeaderStruct)));
+    }
+
+    return offset;
+}
+
+void ZBossSimulator::deviceAnnounce(const VirtualDevice &device)
+{
+    zbossDeviceAnnounceStruct announce;
+
+    announce.networkAddress = qToLittleEndian(device->networkAddress());
+    announce.ieeeAddress = qToLittleEndian(device->ieeeAddress());
+    announce.capabilities = 0x80;
+
+    sendPacket(ZBOSS_TYPE_INDICATION, ZBOSS_ZDO_DEV_ANNCE_IND, QByteArray(reinterpret_cast <char*> (&announce), sizeof(announce)));
+}
+
+void ZBossSimulator::zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    zbossIncomingMessageStruct message;
+
+    memset(&message, 0, sizeof(message));
+
+    message.requestLength = static_cast <quint8> (sizeof(message) - 3);
+    message.dataLength = qToLittleEndian <quint16> (payload.length());
+    message.srcAddress = qToLittleEndian(device->networkAddress());
+    message.dstEndpointId = 0x01;
+    message.srcEndpointId = endpointId;
+    message.clusterId = qToLittleEndian(clusterId);
+    message.profileId = qToLittleEndian <quint16> (PROFILE_HA);
+    message.linkQuality = 0xFF;
+
+    sendPacket(ZBOSS_TYPE_INDICATION, ZBOSS_APSDE_DATA_IND, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)).append(payload));
+}
+
+void ZBossSimulator::zdoMessage(const VirtualDevice &, quint16 clusterId, quint8 transactionId, const QByteArray &payload)
+{
+    quint8 status = static_cast <quint8> (payload.at(0));
+    QByteArray networkAddress = payload.mid(1, 2);
+
+    switch (clusterId & 0x7FFF)
+    {
+        case ZDO_NODE_DESCRIPTOR_REQUEST:
+        {
+            sendResponse(ZBOSS_ZDO_NODE_DESC_REQ, transactionId, status, payload.mid(3).append(networkAddress));
+            break;
+        }
+
+        case ZDO_SIMPLE_DESCRIPTOR_REQUEST:
+        {
+            QByteArray data;
+            quint8 inClustersCount, outClustersCount;
+
+            if (status)
+            {
+                sendResponse(ZBOSS_ZDO_SIMPLE_DESC_REQ, transactionId, status, networkAddress);
+                break;
+            }
+
+            inClustersCount = static_cast <quint8> (payload.at(10));
+            outClustersCount = static_cast <quint8> (payload.at(11 + inClustersCount * 2));
+
+            data.append(payload.mid(4, 6));
+            data.append(static_cast <char> (inClustersCount));
+            data.append(static_cast <char> (outClustersCount));
+            data.append(payload.mid(11, inClustersCount * 2));
+            data.append(payload.mid(12 + inClustersCount * 2, outClustersCount * 2));
+
+            sendResponse(ZBOSS_ZDO_SIMPLE_DESC_REQ, transactionId, status, data.append(networkAddress));
+            break;
+        }
+
+        case ZDO_ACTIVE_ENDPOINTS_REQUEST:
+        {
+            sendResponse(ZBOSS_ZDO_ACTIVE_EP_REQ, transactionId, status, payload.mid(3).append(networkAddress));
+            break;
+        }
+
+        case ZDO_BIND_REQUEST:
+        case ZDO_UNBIND_REQUEST:
+        {
+            sendResponse((clusterId & 0x7FFF) == ZDO_BIND_REQUEST ? ZBOSS_ZDO_BIND_REQ : ZBOSS_ZDO_UNBIND_REQ, transactionId, status);
+            break;
+        }
+
+        case ZDO_LEAVE_REQUEST:
+        {
+            sendResponse(ZBOSS_ZDO_MGMT_LEAVE_REQ, transactionId, status);
+            break;
+        }
+
+        case ZDO_LQI_REQUEST:
+        {
+            sendResponse(ZBOSS_ZDO_MGMT_LQI_REQ, transactionId, status, payload.mid(1));
+            break;
+        }
+    }
+}
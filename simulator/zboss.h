@@ -0,0 +1,39 @@
+#ifndef SIMULATOR_ZBOSS_H
+#define SIMULATOR_ZBOSS_H
+
+#define ZBOSS_TYPE_INDICATION           0x02
+#define ZBOSS_STATUS_APS_NO_ACK         0xA7
+
+#include "../zboss.h"
+#include "simulator.h"
+
+class ZBossSimulator : public Simulator
+{
+    Q_OBJECT
+
+public:
+
+    ZBossSimulator(QSettings *config, QObject *parent) : Simulator(config, parent), m_sequenceId(0) {}
+
+private:
+
+    quint8 m_sequenceId;
+
+    quint8 getCRC8(const quint8 *data, quint32 length);
+    quint16 getCRC16(const quint8 *data, quint32 length);
+
+    void sendFrame(quint8 flags, const QByteArray &payload = QByteArray());
+    void sendPacket(quint8 type, quint16 command, const QByteArray &data);
+    void sendResponse(quint16 command, quint8 transactionId, quint8 status = 0x00, const QByteArray &data = QByteArray());
+    void parsePacket(quint8 type, quint16 command, const QByteArray &data);
+
+    void reset(void) override;
+    int parseData(const QByteArray &buffer) override;
+
+    void deviceAnnounce(const VirtualDevice &device) override;
+    void zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload) override;
+    void zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload) override;
+
+};
+
+#endif
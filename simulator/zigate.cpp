@@ -0,0 +1,258 @@
+#include <QtEndian>
+#include "zigate.h"
+#include "logger.h"
+
+void ZiGateSimulator::sendRequest(quint16 command, const QByteArray &data)
+{
+    QByteArray payload = QByteArray(data).append(static_cast <char> (0xFF)), packet, frame(1, 0x01);
+    zigateHeaderStruct header;
+
+    header.command = qToBigEndian(command);
+    header.length = qToBigEndian <quint16> (payload.length());
+    header.checksum = 0;
+
+    packet = QByteArray(reinterpret_cast <char*> (&header), 4).append(payload);
+
+    for (int i = 0; i < packet.length(); i++)
+        header.checksum ^= packet.at(i);
+
+    packet.insert(4, static_cast <char> (header.checksum));
+
+    for (int i = 0; i < packet.length(); i++)
+    {
+        if (packet.at(i) < 0x10)
+            frame.append(1, 0x02);
+
+        frame.append(1, packet.at(i) < 0x10 ? packet.at(i) ^ 0x10 : packet.at(i));
+    }
+
+    sendData(frame.append(1, 0x03));
+}
+
+void ZiGateSimulator::sendStatus(quint16 command, quint8 status)
+{
+    zigateStatusStruct reply;
+
+    reply.status = status;
+    reply.sequence = m_sequenceId;
+    reply.command = qToBigEndian(command);
+
+    sendRequest(ZIGATE_STATUS, QByteArray(reinterpret_cast <char*> (&reply), sizeof(reply)));
+}
+
+void ZiGateSimulator::parsePacket(quint16 command, const QByteArray &data)
+{
+    quint8 sequenceId = ++m_sequenceId;
+    quint16 networkAddress = 0, clusterId = 0;
+
+    if (data.length() >= 2)
+    {
+        memcpy(&networkAddress, data.constData(), sizeof(networkAddress));
+        networkAddress = qFromBigEndian(networkAddress);
+    }
+
+    switch (command)
+    {
+        case ZIGATE_RESET:
+            sendRequest(ZIGATE_RESTART_NON_FACTORY, QByteArray(1, 0x00));
+            return;
+
+        case ZIGATE_ERASE_PERSISTENT_DATA:
+            sendRequest(ZIGATE_RESTART_FACTORY, QByteArray(1, 0x00));
+            return;
+
+        case ZIGATE_GET_VERSION:
+            sendStatus(command);
+            sendRequest(command | 0x8000, QByteArray::fromHex("0001031d"));
+            return;
+
+        case ZIGATE_GET_NETWORK_STATUS:
+        {
+            zigateNetworkStatusStruct status;
+
+            status.networkAddress = 0x0000;
+            status.ieeeAddress = qToBigEndian(m_ieeeAddress);
+            status.panId = qToBigEndian(m_panId);
+            status.extendedPanId = qToBigEndian(m_ieeeAddress);
+            status.channel = m_channel;
+
+            sendStatus(command);
+            sendRequest(command | 0x8000, QByteArray(reinterpret_cast <char*> (&status), sizeof(status)));
+            return;
+        }
+
+        case ZIGATE_START_NETWORK:
+        {
+            quint64 ieeeAddress = qToBigEndian(m_ieeeAddress);
+            sendStatus(command);
+            sendRequest(command | 0x8000, QByteArray(3, 0x00).append(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)).append(static_cast <char> (m_channel)));
+            return;
+        }
+
+        case ZIGATE_SET_PERMIT_JOIN:
+            sendStatus(command);
+            setPermitJoin(data.at(2) ? true : false);
+            return;
+
+        case ZIGATE_APS_REQUEST:
+        {
+            const zigateApsRequestStruct *request = reinterpret_cast <const zigateApsRequestStruct*> (data.constData());
+            zigateDataAcknowledgeStruct acknowledge;
+
+            acknowledge.status = 0x00;
+            acknowledge.networkAddress = request->address;
+            acknowledge.endpointId = request->dstEndpointId;
+            acknowledge.clusterId = request->clusterId;
+            acknowledge.sequence = sequenceId;
+
+            sendStatus(command);
+
+            if (request->addressMode == ADDRESS_MODE_GROUP)
+            {
+                multicastRequest([this, acknowledge] (bool) { sendRequest(ZIGATE_DATA_ACK, QByteArray(reinterpret_cast <const char*> (&acknowledge), sizeof(acknowledge))); });
+                return;
+            }
+
+            unicastRequest(qFromBigEndian(request->address), request->dstEndpointId, qFromBigEndian(request->clusterId), data.mid(sizeof(zigateApsRequestStruct), request->length), [this, acknowledge] (bool delivered) mutable
+            {
+                acknowledge.status = delivered ? 0x00 : ZIGATE_STATUS_APS_NO_ACK;
+                sendRequest(ZIGATE_DATA_ACK, QByteArray(reinterpret_cast <char*> (&acknowledge), sizeof(acknowledge)));
+            });
+
+            return;
+        }
+
+        case ZIGATE_BIND_REQUEST:
+        case ZIGATE_UNBIND_REQUEST:
+        {
+            const bindRequestStruct *request = reinterpret_cast <const bindRequestStruct*> (data.constData());
+            VirtualDevice device = findDevice(qFromBigEndian(request->srcAddress));
+
+            sendStatus(command, device.isNull() ? 0x01 : 0x00);
+
+            if (device.isNull())
+                return;
+
+            networkAddress = device->networkAddress();
+            clusterId = command == ZIGATE_BIND_REQUEST ? ZDO_BIND_REQUEST : ZDO_UNBIND_REQUEST;
+            break;
+        }
+
+        case ZIGATE_NODE_DESCRIPTOR_REQUEST:   clusterId = ZDO_NODE_DESCRIPTOR_REQUEST; sendStatus(command); break;
+        case ZIGATE_SIMPLE_DESCRIPTOR_REQUEST: clusterId = ZDO_SIMPLE_DESCRIPTOR_REQUEST; sendStatus(command); break;
+        case ZIGATE_ACTIVE_ENDPOINTS_REQUEST:  clusterId = ZDO_ACTIVE_ENDPOINTS_REQUEST; sendStatus(command); break;
+        case ZIGATE_LEAVE_REQUEST:             clusterId = ZDO_LEAVE_REQUEST; sendStatus(command); break;
+        case ZIGATE_LQI_REQUEST:               clusterId = ZDO_LQI_REQUEST; sendStatus(command); break;
+
+        default:
+            sendStatus(command);
+            return;
+    }
+
+    switch (clusterId)
+    {
+        case ZDO_SIMPLE_DESCRIPTOR_REQUEST:
+        {
+            quint16 value = qToLittleEndian(networkAddress);
+            zdoRequest(networkAddress, clusterId, sequenceId, QByteArray(reinterpret_cast <char*> (&value), sizeof(value)).append(data.mid(2, 1)), [] (bool) {});
+            break;
+        }
+
+        case ZDO_LQI_REQUEST:
+            zdoRequest(networkAddress, clusterId, sequenceId, data.mid(2, 1), [] (bool) {});
+            break;
+
+        default:
+            zdoRequest(networkAddress, clusterId, sequenceId, QByteArray(), [] (bool) {});
+            break;
+    }
+}
+
+void ZiGateSimulator::dataIndication(const VirtualDevice &device, quint16 profileId, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    quint16 networkAddress = qToBigEndian(device->networkAddress());
+    zigateDataIndicatonStruct message;
+
+    message.status = 0x00;
+    message.profileId = qToBigEndian(profileId);
+    message.clusterId = qToBigEndian(clusterId);
+    message.srcEndpointId = endpointId;
+    message.dstEndpointId = endpointId ? 0x01 : 0x00;
+
+    sendRequest(ZIGATE_DATA_INDICATION, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)).append(1, ADDRESS_MODE_16_BIT).append(reinterpret_cast <char*> (&networkAddress), sizeof(networkAddress)).append(1, ADDRESS_MODE_16_BIT).append(2, 0x00).append(payload));
+}
+
+void ZiGateSimulator::reset(void)
+{
+    m_sequenceId = 0;
+}
+
+int ZiGateSimulator::parseData(const QByteArray &buffer)
+{
+    int offset = 0;
+
+    while (offset < buffer.length())
+    {
+        int index = buffer.indexOf(0x01, offset), length;
+        const zigateHeaderStruct *header;
+        QByteArray packet, payload;
+        quint8 checksum = 0;
+
+        if (index < 0)
+            return buffer.length();
+
+        offset = index;
+        length = buffer.indexOf(0x03, offset) - offset;
+
+        if (length < 0)
+            break;
+
+        for (int i = offset + 1; i < offset + length; i++)
+            packet.append(static_cast <char> (buffer.at(i) == 0x02 ? buffer.at(++i) ^ 0x10 : buffer.at(i)));
+
+        offset += length + 1;
+
+        if (packet.length() < static_cast <int> (sizeof(zigateHeaderStruct)))
+            continue;
+
+        header = reinterpret_cast <const zigateHeaderStruct*> (packet.constData());
+        payload = packet.mid(sizeof(zigateHeaderStruct), qFromBigEndian(header->length));
+
+        for (int i = 0; i < 4; i++)
+            checksum ^= packet.at(i);
+
+        for (int i = 0; i < payload.length(); i++)
+            checksum ^= payload.at(i);
+
+        if (checksum != header->checksum)
+        {
+            logWarning << "Packet" << packet.toHex(':') << "checksum mismatch";
+            continue;
+        }
+
+        parsePacket(qFromBigEndian(header->command), payload);
+    }
+
+    return offset;
+}
+
+void ZiGateSimulator::deviceAnnounce(const VirtualDevice &device)
+{
+    deviceAnnounceStruct announce;
+
+    announce.networkAddress = qToBigEndian(device->networkAddress());
+    announce.ieeeAddress = qToBigEndian(device->ieeeAddress());
+    announce.capabilities = 0x80;
+
+    sendRequest(ZIGATE_DEVICE_ANNOUNCE, QByteArray(reinterpret_cast <char*> (&announce), sizeof(announce)));
+}
+
+void ZiGateSimulator::zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    dataIndication(device, PROFILE_HA, endpointId, clusterId, payload);
+}
+
+void ZiGateSimulator::zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload)
+{
+    dataIndication(device, 0x0000, 0x00, clusterId, QByteArray(1, static_cast <char> (transactionId)).append(payload));
+}
@@ -0,0 +1,36 @@
+#ifndef SIMULATOR_ZIGATE_H
+#define SIMULATOR_ZIGATE_H
+
+#define ZIGATE_STATUS_APS_NO_ACK        0xA7
+
+#include "../zigate.h"
+#include "simulator.h"
+
+class ZiGateSimulator : public Simulator
+{
+    Q_OBJECT
+
+public:
+
+    ZiGateSimulator(QSettings *config, QObject *parent) : Simulator(config, parent), m_sequenceId(0) {}
+
+private:
+
+    quint8 m_sequenceId;
+
+    void sendRequest(quint16 command, const QByteArray &data = QByteArray());
+    void sendStatus(quint16 command, quint8 status = 0x00);
+    void parsePacket(quint16 command, const QByteArray &data);
+
+    void dataIndication(const VirtualDevice &device, quint16 profileId, quint8 endpointId, quint16 clusterId, const QByteArray &payload);
+
+    void reset(void) override;
+    int parseData(const QByteArray &buffer) override;
+
+    void deviceAnnounce(const VirtualDevice &device) override;
+    void zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload) override;
+    void zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload) override;
+
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include <QtEndian>
+#include "zstack.h"
+#include "logger.h"
+
+ZStackSimulator::ZStackSimulator(QSettings *config, QObject *parent) : Simulator(config, parent)
+{
+    quint32 channelList = qToLittleEndian <quint32> (1 << m_channel);
+    quint16 panId = qToLittleEndian(m_panId);
+
+    m_nvItems.insert(ZCD_NV_PRECFGKEY,         m_networkKey);
+    m_nvItems.insert(ZCD_NV_PRECFGKEYS_ENABLE, QByteArray(1, 0x01));
+    m_nvItems.insert(ZCD_NV_PANID,             QByteArray(reinterpret_cast <char*> (&panId), sizeof(panId)));
+    m_nvItems.insert(ZCD_NV_CHANLIST,          QByteArray(reinterpret_cast <char*> (&channelList), sizeof(channelList)));
+    m_nvItems.insert(ZCD_NV_LOGICAL_TYPE,      QByteArray(1, 0x00));
+    m_nvItems.insert(ZCD_NV_ZDO_DIRECT_CB,     QByteArray(1, 0x01));
+}
+
+void ZStackSimulator::sendRequest(quint16 command, const QByteArray &data)
+{
+    QByteArray request;
+    quint16 value = qToBigEndian(command);
+    quint8 fcs = 0;
+
+    request.append(static_cast <char> (ZSTACK_PACKET_FLAG));
+    request.append(static_cast <char> (data.length()));
+    request.append(reinterpret_cast <char*> (&value), sizeof(value));
+    request.append(data);
+
+    for (int i = 1; i < request.length(); i++)
+        fcs ^= request[i];
+
+    sendData(request.append(static_cast <char> (fcs)));
+}
+
+void ZStackSimulator::parsePacket(quint16 command, const QByteArray &data)
+{
+    quint16 reply = command ^ 0x4000;
+
+    switch (command)
+    {
+        case ZSTACK_SYS_RESET_REQ:
+        {
+            sendRequest(ZSTACK_SYS_RESET_IND, QByteArray::fromHex("000201020701"));
+            break;
+        }
+
+        case ZSTACK_SYS_VERSION:
+        {
+            zstackVersionStruct version;
+
+            version.transport = 0x02;
+            version.product = 0x01;
+            version.major = 0x02;
+            version.minor = 0x07;
+            version.patch = 0x01;
+            version.build = qToLittleEndian <quint32> (20230507);
+
+            sendRequest(reply, QByteArray(reinterpret_cast <char*> (&version), sizeof(version)));
+            break;
+        }
+
+        case ZSTACK_UTIL_GET_DEVICE_INFO:
+        {
+            quint64 ieeeAddress = qToLittleEndian(m_ieeeAddress);
+            sendRequest(reply, QByteArray(1, 0x00).append(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)).append(QByteArray::fromHex("0000070900")));
+            break;
+        }
+
+        case ZSTACK_SYS_OSAL_NV_READ:
+        {
+            const zstackNvReadStruct *request = reinterpret_cast <const zstackNvReadStruct*> (data.constData());
+            auto it = m_nvItems.find(qFromLittleEndian(request->id));
+
+            if (it == m_nvItems.end())
+            {
+                sendRequest(reply, QByteArray(1, 0x02).append(1, 0x00));
+                break;
+            }
+
+            sendRequest(reply, QByteArray(1, 0x00).append(static_cast <char> (it.value().length())).append(it.value()));
+            break;
+        }
+
+        case ZSTACK_SYS_OSAL_NV_WRITE:
+        {
+            const zstackNvWriteStruct *request = reinterpret_cast <const zstackNvWriteStruct*> (data.constData());
+            m_nvItems.insert(qFromLittleEndian(request->id), data.mid(sizeof(zstackNvWriteStruct), request->length));
+            sendRequest(reply, QByteArray(1, 0x00));
+            break;
+        }
+
+        case ZSTACK_ZDO_STARTUP_FROM_APP:
+        {
+            sendRequest(reply, QByteArray(1, 0x00));
+            sendRequest(ZSTACK_ZDO_STATE_CHANGE_IND, QByteArray(1, ZSTACK_COORDINATOR_STARTED));
+            sendRequest(ZSTACK_APP_CNF_BDB_COMMISSIONING, QByteArray(3, 0x00));
+            break;
+        }
+
+        case ZSTACK_ZDO_MGMT_PERMIT_JOIN_REQ:
+        {
+            const zstackPermitJoinStruct *request = reinterpret_cast <const zstackPermitJoinStruct*> (data.constData());
+            sendRequest(reply, QByteArray(1, 0x00));
+            setPermitJoin(request->duration ? true : false);
+            break;
+        }
+
+        case ZSTACK_AF_DATA_REQUEST:
+        {
+            const zstackDataRequestStruct *request = reinterpret_cast <const zstackDataRequestStruct*> (data.constData());
+            quint8 endpointId = request->srcEndpointId, transactionId = request->transactionId;
+
+            sendRequest(reply, QByteArray(1, 0x00));
+
+            unicastRequest(qFromLittleEndian(request->networkAddress), request->dstEndpointId, qFromLittleEndian(request->clusterId), data.mid(sizeof(zstackDataRequestStruct), request->length), [this, endpointId, transactionId] (bool delivered)
+            {
+                zstackDataConfirmStruct confirm;
+
+                confirm.status = delivered ? 0x00 : ZSTACK_STATUS_MAC_NO_ACK;
+                confirm.endpointId = endpointId;
+                confirm.transactionId = transactionId;
+
+                sendRequest(ZSTACK_AF_DATA_CONFIRM, QByteArray(reinterpret_cast <char*> (&confirm), sizeof(confirm)));
+            });
+
+            break;
+        }
+
+        case ZSTACK_AF_DATA_REQUEST_EXT:
+        {
+            const zstackExtendedRequestStruct *request = reinterpret_cast <const zstackExtendedRequestStruct*> (data.constData());
+            quint8 endpointId = request->srcEndpointId, transactionId = request->transactionId;
+
+            sendRequest(reply, QByteArray(1, 0x00));
+
+            multicastRequest([this, endpointId, transactionId] (bool)
+            {
+                zstackDataConfirmStruct confirm;
+
+                confirm.status = 0x00;
+                confirm.endpointId = endpointId;
+                confirm.transactionId = transactionId;
+
+                sendRequest(ZSTACK_AF_DATA_CONFIRM, QByteArray(reinterpret_cast <char*> (&confirm), sizeof(confirm)));
+            });
+
+            break;
+        }
+
+        default:
+        {
+            if (command & 0x2000)
+                sendRequest(reply, QByteArray(1, 0x00));
+
+            break;
+        }
+    }
+}
+
+void ZStackSimulator::reset(void)
+{
+
+}
+
+int ZStackSimulator::parseData(const QByteArray &buffer)
+{
+    int offset = 0;
+
+    while (offset < buffer.length())
+    {
+        int index = buffer.indexOf(static_cast <char> (ZSTACK_PACKET_FLAG), offset);
+        const char *frame;
+        quint16 command;
+        quint8 length, fcs = 0;
+
+        if (index < 0)
+            return buffer.length();
+
+        offset = index;
+
+        if (buffer.length() - offset < 5)
+            break;
+
+        frame = buffer.constData() + offset;
+        length = static_cast <quint8> (frame[1]);
+
+        if (buffer.length() - offset < length + 5)
+            break;
+
+        for (int i = 1; i < length + 4; i++)
+            fcs ^= frame[i];
+
+        if (fcs != static_cast <quint8> (frame[length + 4]))
+        {
+            logWarning << "Frame" << buffer.mid(offset, length + 5).toHex(':') << "FCS mismatch";
+            offset++;
+            continue;
+        }
+
+        memcpy(&command, frame + 2, sizeof(command));
+        parsePacket(qFromBigEndian(command), QByteArray(frame + 4, length));
+        offset += length + 5;
+    }
+
+    return offset;
+}
+
+void ZStackSimulator::deviceAnnounce(const VirtualDevice &device)
+{
+    quint16 networkAddress = qToLittleEndian(device->networkAddress());
+    deviceAnnounceStruct announce;
+
+    announce.networkAddress = networkAddress;
+    announce.ieeeAddress = qToLittleEndian(device->ieeeAddress());
+    announce.capabilities = 0x80;
+
+    sendRequest(ZSTACK_ZDO_END_DEVICE_ANNCE_IND, QByteArray(reinterpret_cast <char*> (&networkAddress), sizeof(networkAddress)).append(reinterpret_cast <char*> (&announce), sizeof(announce)));
+}
+
+void ZStackSimulator::zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload)
+{
+    zstackIncomingMessageStruct message;
+
+    memset(&message, 0, sizeof(message));
+
+    message.clusterId = qToLittleEndian(clusterId);
+    message.srcAddress = qToLittleEndian(device->networkAddress());
+    message.srcEndpointId = endpointId;
+    message.dstEndpointId = 0x01;
+    message.linkQuality = 0xFF;
+    message.length = static_cast <quint8> (payload.length());
+
+    sendRequest(ZSTACK_AF_INCOMING_MSG, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)).append(payload));
+}
+
+void ZStackSimulator::zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload)
+{
+    zstackZdoMessageStruct message;
+
+    message.srcAddress = qToLittleEndian(device->networkAddress());
+    message.broadcast = 0x00;
+    message.clusterId = qToLittleEndian(clusterId);
+    message.security = 0x00;
+    message.transactionId = transactionId;
+    message.dstAddress = 0x0000;
+
+    sendRequest(ZSTACK_ZDO_MSG_CB_INCOMING, QByteArray(reinterpret_cast <char*> (&message), sizeof(message)).append(payload));
+}
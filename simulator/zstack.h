@@ -0,0 +1,33 @@
+#ifndef SIMULATOR_ZSTACK_H
+#define SIMULATOR_ZSTACK_H
+
+#define ZSTACK_STATUS_MAC_NO_ACK        0xE9
+
+#include "../zstack.h"
+#include "simulator.h"
+
+class ZStackSimulator : public Simulator
+{
+    Q_OBJECT
+
+public:
+
+    ZStackSimulator(QSettings *config, QObject *parent);
+
+private:
+
+    QMap <quint16, QByteArray> m_nvItems;
+
+    void sendRequest(quint16 command, const QByteArray &data = QByteArray());
+    void parsePacket(quint16 command, const QByteArray &data);
+
+    void reset(void) override;
+    int parseData(const QByteArray &buffer) override;
+
+    void deviceAnnounce(const VirtualDevice &device) override;
+    void zclMessage(const VirtualDevice &device, quint8 endpointId, quint16 clusterId, const QByteArray &payload) override;
+    void zdoMessage(const VirtualDevice &device, quint16 clusterId, quint8 transactionId, const QByteArray &payload) override;
+
+};
+
+#endif
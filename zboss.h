@@ -2,6 +2,8 @@
 #define ZBOSS_H
 
 #define ZBOSS_REQUEST_TIMEOUT                           2000
+#define ZBOSS_ACKNOWLEDGE_TIMEOUT                       500
+#define ZBOSS_MAX_RETRIES                               3
 #define ZBOSS_RESET_DELAY                               2000
 
 #define ZBOSS_SIGNATURE                                 0xDEAD
@@ -15,6 +17,7 @@
 #define ZBOSS_TYPE_RESPONSE                             0x01
 
 #define ZBOSS_FLAG_ACK                                  0x01
+#define ZBOSS_FLAG_RETRANSMIT                           0x02
 #define ZBOSS_FLAG_FIRST_FRAGMENT                       0x40
 #define ZBISS_FLAG_LAST_FRAGMENT                        0x80
 
@@ -228,39 +231,47 @@ public:
     bool leaveRequest(quint8 id, quint16 networkAddress) override;
     bool lqiRequest(quint8 id, quint16 networkAddress, quint8 index) override;
 
+    static quint8 getCRC8(const quint8 *data, quint32 length);
+    static quint16 getCRC16(const quint8 *data, quint32 length);
+
 private:
 
     bool m_clear;
 
+    QTimer *m_acknowledgeTimer;
+
     quint16 m_command;
     QByteArray m_replyData;
 
-    quint8 m_sequenceId, m_acknowledgeId;
-    quint16 m_lqiRequestAddress;
+    quint8 m_sequenceId, m_acknowledgeId, m_retries;
+    QQueue <QByteArray> m_frames;
 
-    QList <zbossSetPolicyStruct> m_policy;
+    QMap <quint8, quint16> m_requests, m_lqiRequests;
 
-    quint8 getCRC8(quint8 *data, quint32 length);
-    quint16 getCRC16(quint8 *data, quint32 length);
+    QList <zbossSetPolicyStruct> m_policy;
 
+    void enqueueRequest(quint16 command, const QByteArray &data, quint8 id);
     bool sendRequest(quint16 command, const QByteArray &data = QByteArray(), quint8 id = 0);
+    bool dataRequest(quint16 command, const QByteArray &data, quint8 id);
+
+    void sendFrame(bool retransmit = false);
     void sendAcknowledge(void);
     void parsePacket(quint8 type, quint16 command, const QByteArray &data);
 
     bool startCoordinator(void);
 
     void softReset(void) override;
-    void parseData(QByteArray &buffer) override;
+    int parseData(const QByteArray &buffer) override;
     bool permitJoin(bool enabled) override;
 
 private slots:
 
     void handleQueue(void) override;
+    void acknowledgeTimeout(void);
     void serialError(QSerialPort::SerialPortError error) override;
 
 signals:
 
-    void acknowledgeReceived(void);
     void dataReceived(void);
 
 };
@@ -308,6 +308,12 @@ struct iasZoneEnrollResponseStruct
     quint8  zoneId;
 };
 
+struct pollControlCheckInResponseStruct
+{
+    quint8  startFastPolling;
+    quint16 fastPollTimeout;
+};
+
 struct iasStartWarningStruct
 {
     quint8  warning;
@@ -339,7 +339,7 @@ bool ZiGate::startCoordinator(bool clear)
     }
 
     logInfo << "ZiGate managed PAN ID:" << QString::asprintf("0x%04x", qFromBigEndian(networkStatus.panId));
-    emit coordinatorReady();
+    emit coordinatorReady(m_ieeeAddress, m_manufacturerName, m_modelName, m_firmware);
     return true;
 }
 
@@ -365,25 +365,47 @@ void ZiGate::softReset(void)
     sendRequest(ZIGATE_RESET);
 }
 
-void ZiGate::parseData(QByteArray &buffer)
+int ZiGate::parseData(const QByteArray &buffer)
 {
-    while (!buffer.isEmpty())
+    int offset = 0;
+
+    while (offset < buffer.length())
     {
-        int length = buffer.indexOf(0x03);
-        QByteArray frame, packet;
+        int index = buffer.indexOf(0x01, offset), length, size = 0;
+        const char *frame;
+        char *data;
+        QByteArray packet;
+
+        if (index < 0)
+            return buffer.length();
+
+        offset = index;
+        length = buffer.indexOf(0x03, offset) - offset;
+
+        if (length < 0)
+            break;
 
-        if (!buffer.startsWith(0x01) || length < 6)
-            return;
+        if (length < 6)
+        {
+            offset += length + 1;
+            continue;
+        }
 
-        logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length + 1).toHex(':');
-        frame = buffer.mid(1, length - 1);
+        logDebug(m_portDebug) << "Frame received:" << buffer.mid(offset, length + 1).toHex(':');
 
-        for (int i = 0; i < frame.length(); i++)
-            packet.append(1, frame.at(i) == 0x02 ? frame.at(++i) ^ 0x10 : frame.at(i));
+        frame = buffer.constData() + offset + 1;
+        packet.resize(length - 1);
+        data = packet.data();
 
+        for (int i = 0; i < length - 1; i++)
+            data[size++] = frame[i] == 0x02 ? frame[++i] ^ 0x10 : frame[i];
+
+        packet.resize(size);
         m_queue.enqueue(packet);
-        buffer.remove(0, length + 1);
+        offset += length + 1;
     }
+
+    return offset;
 }
 
 bool ZiGate::permitJoin(bool enabled)
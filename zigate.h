@@ -146,7 +146,7 @@ private:
     bool apsRequest(quint8 id, quint8 addressMode, quint16 address, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload);
 
     void softReset(void) override;
-    void parseData(QByteArray &buffer) override;
+    int parseData(const QByteArray &buffer) override;
     bool permitJoin(bool enabled) override;
 
 private slots:
@@ -1,6 +1,7 @@
 #include <QtEndian>
 #include <QEventLoop>
 #include <QRandomGenerator>
+#include <QSemaphore>
 #include "ezsp.h"
 #include "gpio.h"
 #include "logger.h"
@@ -10,7 +11,55 @@
 #include "zigbee.h"
 #include "zstack.h"
 
-ZigBee::ZigBee(QSettings *config, QObject *parent) : QObject(parent), m_config(config), m_requestTimer(new QTimer(this)), m_neignborsTimer(new QTimer(this)), m_pingTimer(new QTimer(this)), m_statusLedTimer(new QTimer(this)), m_adapter(nullptr), m_devices(new DeviceList(m_config, this)), m_events(QMetaEnum::fromType <Event> ()), m_requestId(0), m_interPanLock(false)
+void RequestQueue::enqueue(const QByteArray &ieeeAddress, quint32 id)
+{
+    auto it = m_requests.find(ieeeAddress);
+
+    if (it == m_requests.end())
+    {
+        it = m_requests.insert(ieeeAddress, QQueue <quint32> ());
+        m_devices.enqueue(ieeeAddress);
+    }
+
+    it.value().enqueue(id);
+}
+
+bool RequestQueue::dequeue(quint32 &id, const RequestFilter &filter)
+{
+    for (int i = 0; i < m_devices.count(); i++)
+    {
+        QByteArray ieeeAddress = m_devices.dequeue();
+        auto it = m_requests.find(ieeeAddress);
+
+        if (filter && !filter(it.value().head()))
+        {
+            m_devices.enqueue(ieeeAddress);
+            continue;
+        }
+
+        id = it.value().dequeue();
+
+        if (it.value().isEmpty())
+            m_requests.erase(it);
+        else
+            m_devices.enqueue(ieeeAddress);
+
+        m_active++;
+        return true;
+    }
+
+    return false;
+}
+
+void RequestQueue::remove(const QByteArray &ieeeAddress)
+{
+    if (!m_requests.remove(ieeeAddress))
+        return;
+
+    m_devices.removeAll(ieeeAddress);
+}
+
+ZigBee::ZigBee(QSettings *config, QObject *parent) : QObject(parent), m_config(config), m_requestTimer(new QTimer(this)), m_timeoutTimer(new QTimer(this)), m_neignborsTimer(new QTimer(this)), m_pingTimer(new QTimer(this)), m_statusLedTimer(new QTimer(this)), m_adapterThread(new QThread(this)), m_adapter(nullptr), m_devices(new DeviceList(m_config, this)), m_events(QMetaEnum::fromType <Event> ()), m_requestId(0), m_configurationId(0), m_adapterTag(0), m_interPanLock(false)
 {
     m_statusLedPin = m_config->value("gpio/status", "-1").toString();
     m_blinkLedPin = m_config->value("gpio/blink", "-1").toString();
@@ -19,9 +68,23 @@ ZigBee::ZigBee(QSettings *config, QObject *parent) : QObject(parent), m_config(c
     m_cloud = m_config->value("default/cloud", true).toBool();
     m_debug = m_config->value("debug/zigbee", false).toBool();
 
+    m_requestRetries = qBound(0, m_config->value("zigbee/retries", 2).toInt(), 10);
+    m_requestBackoff = qBound(100, m_config->value("zigbee/backoff", 500).toInt(), REQUEST_MAX_BACKOFF);
+    m_requestRate = qBound(1, m_config->value("zigbee/rate", 10).toInt(), REQUEST_MAX_RATE);
+    m_requestBurst = qBound(1, m_config->value("zigbee/burst", 20).toInt(), REQUEST_MAX_RATE);
+
+    m_queues.insert(RequestPriority::Action, RequestQueue());
+    m_queues.insert(RequestPriority::Response, RequestQueue());
+    m_queues.insert(RequestPriority::OTA, RequestQueue(REQUEST_LIMIT_OTA));
+    m_queues.insert(RequestPriority::Interview, RequestQueue(REQUEST_LIMIT_INTERVIEW));
+    m_queues.insert(RequestPriority::Configuration, RequestQueue(REQUEST_LIMIT_CONFIGURATION));
+    m_queues.insert(RequestPriority::Poll, RequestQueue(REQUEST_LIMIT_POLL));
+    m_queues.insert(RequestPriority::Neighbors, RequestQueue(REQUEST_LIMIT_NEIGHBORS));
+
     connect(m_devices, &DeviceList::statusUpdated, this, &ZigBee::statusUpdated);
     connect(m_devices, &DeviceList::endpointUpdated, this, &ZigBee::endpointUpdated);
     connect(m_devices, &DeviceList::pollRequest, this, &ZigBee::pollRequest);
+    connect(m_timeoutTimer, &QTimer::timeout, this, &ZigBee::expireRequests);
     connect(m_statusLedTimer, &QTimer::timeout, this, &ZigBee::updateStatusLed);
 
     GPIO::direction(m_statusLedPin, GPIO::Output);
@@ -39,9 +102,15 @@ ZigBee::~ZigBee(void)
     if (m_adapter)
     {
         disconnect(m_adapter, &Adapter::permitJoinUpdated, this, &ZigBee::permitJoinUpdated);
-        m_adapter->setPermitJoin(false);
+        m_adapter->clearCalls();
+
+        if (!adapterCall([this] () { m_adapter->setPermitJoin(false); return true; }))
+            logWarning << "Adapter did not respond on shutdown";
     }
 
+    m_adapterThread->quit();
+    m_adapterThread->wait();
+
     GPIO::setStatus(m_statusLedPin, false);
     GPIO::setStatus(m_blinkLedPin, false);
 }
@@ -53,20 +122,30 @@ void ZigBee::init(void)
 
     switch (list.indexOf(adapterType))
     {
-        case 0:  m_adapter = new EZSP(m_config, this); break;
-        case 1:  m_adapter = new ZBoss(m_config, this); break;
-        case 2:  m_adapter = new ZiGate(m_config, this); break;
-        case 3:  m_adapter = new ZStack(m_config, this); break;
+        case 0:  m_adapter = new EZSP(m_config, nullptr); break;
+        case 1:  m_adapter = new ZBoss(m_config, nullptr); break;
+        case 2:  m_adapter = new ZiGate(m_config, nullptr); break;
+        case 3:  m_adapter = new ZStack(m_config, nullptr); break;
         default: logWarning << "Unrecognized adapter type" << adapterType; return;
     }
 
+    m_adapter->moveToThread(m_adapterThread);
+    connect(m_adapterThread, &QThread::finished, m_adapter, &Adapter::deleteLater);
+
     connect(m_adapter, &Adapter::adapterReset, this, &ZigBee::adapterReset);
     connect(m_adapter, &Adapter::coordinatorReady, this, &ZigBee::coordinatorReady);
     connect(m_adapter, &Adapter::permitJoinUpdated, this, &ZigBee::permitJoinUpdated);
     connect(m_adapter, &Adapter::requestFinished, this, &ZigBee::requestFinished);
+    connect(m_adapter, &Adapter::zdoRequestFailed, this, &ZigBee::descriptorFailed);
 
     m_devices->init();
-    m_adapter->init();
+    m_adapterThread->start();
+
+    for (auto it = m_devices->begin(); it != m_devices->end(); it++)
+        if (it.value()->interviewStatus() == InterviewStatus::Finished)
+            storeFingerprint(it.value());
+
+    m_adapter->enqueueCall([this] () { m_adapter->init(); });
 }
 
 void ZigBee::setPermitJoin(bool enabled)
@@ -74,7 +153,7 @@ void ZigBee::setPermitJoin(bool enabled)
     if (!m_adapter)
         return;
 
-    m_adapter->setPermitJoin(enabled);
+    m_adapter->enqueueCall([this, enabled] () { m_adapter->setPermitJoin(enabled); });
 }
 
 void ZigBee::togglePermitJoin(void)
@@ -82,7 +161,7 @@ void ZigBee::togglePermitJoin(void)
     if (!m_adapter)
         return;
 
-    m_adapter->togglePermitJoin();
+    m_adapter->enqueueCall([this] () { m_adapter->togglePermitJoin(); });
 }
 
 void ZigBee::updateDevice(const QString &deviceName, const QString &name, const QString &note, bool active, bool discovery, bool cloud)
@@ -104,9 +183,14 @@ void ZigBee::updateDevice(const QString &deviceName, const QString &name, const
         emit deviceEvent(device.data(), Event::deviceAboutToRename);
 
         if (!other.isNull() && other->removed())
+        {
+            m_devices->unindexDevice(other);
             m_devices->remove(other->ieeeAddress());
+        }
 
+        m_devices->unindexDevice(device);
         device->setName(name.isEmpty() ? device->ieeeAddress().toHex(':') : name.trimmed());
+        m_devices->indexDevice(device);
     }
 
     if (device->active() != active)
@@ -132,13 +216,14 @@ void ZigBee::removeDevice(const QString &deviceName, bool force)
 
     if (!force)
     {
-        enqueueRequest(device, RequestType::Leave);
+        enqueueRequest(device, RequestType::Leave, RequestPriority::Action);
         return;
     }
 
     logInfo << device << "removed (force)";
     emit deviceEvent(device.data(), Event::deviceRemoved);
 
+    abortRequests(device);
     m_devices->removeDevice(device);
     m_devices->storeDatabase();
 }
@@ -158,13 +243,16 @@ void ZigBee::setupDevice(const QString &deviceName, bool reportings)
         return;
     }
 
-    if (!configureDevice(device))
+    configureDevice(device, [device] (bool success)
     {
-        logWarning << device << "configuration failed";
-        return;
-    }
+        if (!success)
+        {
+            logWarning << device << "configuration failed";
+            return;
+        }
 
-    logInfo << device << "configuration updated";
+        logInfo << device << "configuration updated";
+    });
 }
 
 void ZigBee::setupReporting(const QString &deviceName, quint8 endpointId, const QString &reportingName, quint16 minInterval, quint16 maxInterval, quint16 valueChange)
@@ -287,7 +375,7 @@ void ZigBee::otaControl(const QString &deviceName, bool refresh, bool upgrade)
         payload.jitter = 0x64;
 
         logInfo << device << "OTA upgrade notification enqueued";
-        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT, m_requestId, 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)));
+        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT, device->nextTransactionId(), 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)), RequestPriority::OTA);
     }
 }
 
@@ -310,29 +398,42 @@ void ZigBee::getProperties(const QString &deviceName)
 void ZigBee::clusterRequest(const QString &deviceName, quint8 endpointId, quint16 clusterId, quint16 manufacturerCode, quint8 commandId, const QByteArray &payload, bool global)
 {
     const Device &device = m_devices->byName(deviceName);
-    QByteArray request;
+    DataRequest request;
+    quint32 id;
 
     if (device.isNull() || device->removed() || !device->active() || device->logicalType() == LogicalType::Coordinator)
         return;
 
-    request = zclHeader(global ? 0x00 : FC_CLUSTER_SPECIFIC, m_requestId, commandId, manufacturerCode).append(payload);
-    logInfo << "Device" << device->name() << "endpoint" << QString::asprintf("0x%02x", endpointId ? endpointId : 0x01) << "cluster" << QString::asprintf("0x%04x", clusterId) << "request" << m_requestId << "enqueued with data" << request.toHex(':');
-    enqueueRequest(device, endpointId ? endpointId : 0x01, clusterId, request, QString("request %1").arg(m_requestId), true);
+    request = DataRequest(new DataRequestObject(device, endpointId ? endpointId : 0x01, clusterId, zclHeader(global ? 0x00 : FC_CLUSTER_SPECIFIC, device->nextTransactionId(), commandId, manufacturerCode).append(payload), QString(), true, 0, Action()));
+    id = enqueueRequest(Request(new RequestObject(QVariant::fromValue(request), RequestType::Data, RequestPriority::Action)));
+    request->setName(QString("request %1").arg(id));
+
+    logInfo << "Device" << device->name() << "endpoint" << QString::asprintf("0x%02x", request->endpointId()) << "cluster" << QString::asprintf("0x%04x", clusterId) << "request" << id << "enqueued with data" << request->data().toHex(':');
 }
 
 void ZigBee::touchLinkRequest(const QByteArray &ieeeAddress, quint8 channel, bool reset)
 {
+    quint8 tag;
+
     if (m_interPanLock)
         return;
 
+    if (!reserveTag(tag))
+    {
+        logWarning << "TouchLink request aborted, no adapter tags available";
+        return;
+    }
+
     m_interPanLock = true;
 
     if (reset)
-        touchLinkReset(ieeeAddress, channel);
+        touchLinkReset(tag, ieeeAddress, channel);
     else
-        touchLinkScan();
+        touchLinkScan(tag);
 
-    m_adapter->resetInterPanChannel();
+    releaseTag(tag);
+
+    m_adapter->enqueueCall([this] () { m_adapter->resetInterPanChannel(); });
 
     if (!m_requests.isEmpty())
         m_requestTimer->start();
@@ -364,7 +465,24 @@ void ZigBee::deviceAction(const QString &deviceName, quint8 endpointId, const QS
                     continue;
 
                 if (data.type() != QVariant::String || !data.toString().isEmpty())
-                    enqueueRequest(device, it.key(), action->clusterId(), request, QString("%1 action request").arg(name), false, action->manufacturerCode(), action);
+                {
+                    QPair <QByteArray, QString> key(device->ieeeAddress(), QString("%1_%2").arg(name).arg(it.key()));
+                    auto pending = m_actionRequests.find(key);
+
+                    if (data.type() != QVariant::String && pending != m_actionRequests.end())
+                    {
+                        const Request &previous = m_requests.value(pending.value());
+
+                        if (!previous.isNull() && previous->status() == RequestStatus::Pending)
+                        {
+                            logDebug(m_debug) << device << name.toUtf8().constData() << "action request" << pending.value() << "superseded";
+                            previous->setStatus(RequestStatus::Aborted);
+                            requestCallback(previous, false);
+                        }
+                    }
+
+                    m_actionRequests.insert(key, enqueueRequest(device, it.key(), action->clusterId(), request, RequestPriority::Action, QString("%1 action request").arg(name), false, action->manufacturerCode(), action));
+                }
 
                 break;
             }
@@ -384,244 +502,761 @@ void ZigBee::groupAction(quint16 groupId, const QString &name, const QVariant &d
         if (request.isEmpty() || (data.type() == QVariant::String && data.toString().isEmpty()))
             return;
 
-        if (!m_adapter->multicastRequest(m_requestId, groupId, 0x01, 0xFF, action->clusterId(), request))
+        quint16 clusterId = action->clusterId();
+        QString actionName = action->name();
+        quint8 tag;
+
+        if (!reserveTag(tag))
         {
-            logWarning << "Group" << groupId << action->name().toUtf8().constData() << "action request aborted";
+            logWarning << "Group" << groupId << actionName.toUtf8().constData() << "action request aborted, no adapter tags available";
             return;
         }
 
-        logInfo << "Group" << groupId << action->name().toUtf8().constData() << "action request sent";
+        m_adapter->enqueueCall([this, tag, groupId, clusterId, request, actionName] ()
+        {
+            if (!m_adapter->multicastRequest(tag, groupId, 0x01, 0xFF, clusterId, request))
+            {
+                logWarning << "Group" << groupId << actionName.toUtf8().constData() << "action request aborted";
+                return;
+            }
+
+            logInfo << "Group" << groupId << actionName.toUtf8().constData() << "action request sent";
+        });
+
+        releaseTag(tag);
     }
 }
 
-void ZigBee::enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, const QString &name, bool debug, quint16 manufacturerCode, const Action &action)
+quint32 ZigBee::enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, RequestPriority priority, const QString &name, bool debug, quint16 manufacturerCode, const Action &action)
 {
     DataRequest request(new DataRequestObject(device, endpointId, clusterId, data, name, debug, manufacturerCode, action));
+    return enqueueRequest(Request(new RequestObject(QVariant::fromValue(request), RequestType::Data, priority)));
+}
 
-    if (!m_requestTimer->isActive() && !m_interPanLock)
-        m_requestTimer->start();
-
-    m_requests.insert(m_requestId++, Request(new RequestObject(QVariant::fromValue(request), RequestType::Data)));
+quint32 ZigBee::enqueueRequest(const Device &device, RequestType type, RequestPriority priority)
+{
+    return enqueueRequest(Request(new RequestObject(QVariant::fromValue(device), type, priority)));
 }
 
-void ZigBee::enqueueRequest(const Device &device, RequestType type)
+quint32 ZigBee::enqueueRequest(const Request &request)
 {
+    Device device = requestDevice(request);
+    quint32 id = m_requestId++;
+
+    if (request->type() == RequestType::Data && request->priority() != RequestPriority::Response)
+    {
+        const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+
+        if (data->reply())
+            m_transactions.insert(qMakePair(data->device()->ieeeAddress(), data->transactionId()), id);
+    }
+
+    m_requests.insert(id, request);
+
+    if (holdRequest(device, id))
+        return id;
+
     if (!m_requestTimer->isActive() && !m_interPanLock)
         m_requestTimer->start();
 
-    m_requests.insert(m_requestId++, Request(new RequestObject(QVariant::fromValue(device), type)));
+    m_queues[request->priority()].enqueue(device->ieeeAddress(), id);
+    return id;
 }
 
-bool ZigBee::interviewRequest(quint8 id, const Device &device)
+bool ZigBee::requestToken(const Device &device, qint64 time)
 {
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-
-    switch (device->interviewStatus())
-    {
-        case InterviewStatus::NodeDescriptor:
+    double tokens = qMin(device->tokens() + (time - device->tokenTime()) * m_requestRate / 1000.0, static_cast <double> (m_requestBurst));
 
-            if (!m_adapter->zdoRequest(id, device->networkAddress(), ZDO_NODE_DESCRIPTOR_REQUEST))
-            {
-                interviewError(device, "node descriptor request failed");
-                return false;
-            }
-
-            return true;
+    device->setTokenTime(time);
 
-        case InterviewStatus::ActiveEndpoints:
+    if (tokens < 1)
+    {
+        device->setTokens(tokens);
+        return false;
+    }
 
-            if (!m_adapter->zdoRequest(id, device->networkAddress(), ZDO_ACTIVE_ENDPOINTS_REQUEST))
-            {
-                interviewError(device, "active endpoints request failed");
-                return false;
-            }
+    device->setTokens(tokens - 1);
+    return true;
+}
 
-            return true;
+Device ZigBee::requestDevice(const Request &request)
+{
+    switch (request->type())
+    {
+        case RequestType::Data: return qvariant_cast <DataRequest> (request->data())->device();
+        case RequestType::Binding: return qvariant_cast <BindingRequest> (request->data())->endpoint()->device();
+        default: return qvariant_cast <Device> (request->data());
+    }
+}
 
-        case InterviewStatus::SimpleDescriptors:
+bool ZigBee::holdRequest(const Device &device, quint32 id)
+{
+    if (!device->batteryPowered() || device->logicalType() != LogicalType::EndDevice || device->interviewStatus() != InterviewStatus::Finished || device->awakeTime() + SLEEPY_AWAKE_TIMEOUT > QDateTime::currentMSecsSinceEpoch())
+        return false;
 
-            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-            {
-                if (it.value()->descriptorStatus() != DescriptorStatus::Pending)
-                    continue;
+    if (device->mailbox().count() >= SLEEPY_MAILBOX_SIZE)
+    {
+        const Request &request = m_requests.value(device->mailbox().takeFirst());
 
-                device->setInterviewEndpointId(it.key());
+        if (!request.isNull() && request->status() == RequestStatus::Pending)
+        {
+            logWarning << device << "mailbox is full, oldest request dropped";
+            request->setStatus(RequestStatus::Aborted);
+            requestCallback(request, false);
+        }
+    }
 
-                if (!m_adapter->zdoRequest(id, device->networkAddress(), ZDO_SIMPLE_DESCRIPTOR_REQUEST, QByteArray(1, static_cast <char> (it.key()))))
-                {
-                    interviewError(device, QString::asprintf("endpoint 0x%02x simple descriptor request failed", it.key()));
-                    return false;
-                }
+    device->mailbox().append(id);
+    return true;
+}
 
-                return true;
-            }
+void ZigBee::abortRequests(const Device &device)
+{
+    auto fingerprint = m_fingerprints.find(this->fingerprint(device));
+    QList <Request> list;
+    QList <RequestCallback> callbacks;
 
-            device->setInterviewStatus(InterviewStatus::BasicAttributes);
-            return interviewRequest(id, device);
+    if (fingerprint != m_fingerprints.end() && fingerprint.value() == device)
+    {
+        m_fingerprints.erase(fingerprint);
 
-        case InterviewStatus::BasicAttributes:
+        for (auto it = m_devices->begin(); it != m_devices->end(); it++)
+        {
+            if (it.value() == device || it.value()->removed() || it.value()->interviewStatus() != InterviewStatus::Finished || this->fingerprint(it.value()) != this->fingerprint(device))
+                continue;
 
-            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-            {
-                if (!it.value()->inClusters().contains(CLUSTER_BASIC))
-                    continue;
+            storeFingerprint(it.value());
+            break;
+        }
+    }
 
-                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_BASIC, readAttributesRequest(id, 0x0000, {0x0001, 0x0004, 0x0005, 0x0007, 0x4000})))
-                {
-                    interviewError(device, "read basic cluster attributes request failed");
-                    return false;
-                }
+    for (auto it = m_queues.begin(); it != m_queues.end(); it++)
+        it.value().remove(device->ieeeAddress());
 
-                return true;
-            }
+    for (auto it = m_requests.begin(); it != m_requests.end(); it++)
+    {
+        if ((it.value()->status() != RequestStatus::Pending && it.value()->status() != RequestStatus::Sent) || it.value()->type() == RequestType::Leave || requestDevice(it.value()) != device)
+            continue;
 
-            interviewError(device, "no endpoint contains basic cluster");
-            return false;
+        list.append(it.value());
+    }
 
-        case InterviewStatus::ApplicationVersion ... InterviewStatus::FirmwareVersion:
+    for (auto it = m_actionRequests.begin(); it != m_actionRequests.end(); )
+    {
+        if (it.key().first != device->ieeeAddress())
+        {
+            it++;
+            continue;
+        }
 
-            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-            {
-                quint16 attributeId;
+        it = m_actionRequests.erase(it);
+    }
 
-                if (!it.value()->inClusters().contains(CLUSTER_BASIC))
-                    continue;
+    for (auto it = m_readRequests.begin(); it != m_readRequests.end(); )
+    {
+        if (it.key().first != device->ieeeAddress())
+        {
+            it++;
+            continue;
+        }
 
-                switch (device->interviewStatus())
-                {
-                    case InterviewStatus::ApplicationVersion: attributeId = 0x0001; break;
-                    case InterviewStatus::ManufacturerName: attributeId = 0x0004; break;
-                    case InterviewStatus::ModelName: attributeId = 0x0005; break;
-                    case InterviewStatus::PowerSource: attributeId = 0x0007; break;
-                    case InterviewStatus::FirmwareVersion: attributeId = 0x4000; break;
-                    default: return false;
-                }
+        it = m_readRequests.erase(it);
+    }
 
-                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_BASIC, readAttributesRequest(id, 0x0000, {attributeId})))
-                {
-                    interviewError(device, QString::asprintf("read basic cluster attribute 0x%04x request failed", attributeId));
-                    return false;
-                }
+    for (auto it = m_transactions.begin(); it != m_transactions.end(); )
+    {
+        if (it.key().first != device->ieeeAddress())
+        {
+            it++;
+            continue;
+        }
 
-                return true;
-            }
+        it = m_transactions.erase(it);
+    }
 
-            interviewError(device, "no endpoint contains basic cluster");
-            return false;
+    for (int i = 0; i < m_configurationQueue.count(); i++)
+    {
+        if (m_configurationQueue.at(i).first != device)
+            continue;
 
-        case InterviewStatus::ColorCapabilities:
+        callbacks.append(m_configurationQueue.takeAt(i--).second);
+    }
 
-            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-            {
-                if (device->batteryPowered() || !it.value()->inClusters().contains(CLUSTER_COLOR_CONTROL) || it.value()->colorCapabilities() != 0xFFFF)
-                    continue;
+    device->mailbox().clear();
 
-                if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_COLOR_CONTROL, readAttributesRequest(id, 0x0000, {0x400A})))
-                {
-                    interviewError(device, "read color capabilities request failed");
-                    return false;
-                }
+    for (int i = 0; i < list.count(); i++)
+    {
+        list.at(i)->setStatus(RequestStatus::Aborted);
+        requestCallback(list.at(i), false);
+    }
 
-                return true;
-            }
+    for (int i = 0; i < callbacks.count(); i++)
+        callbacks.at(i)(false);
 
-            device->setInterviewStatus(InterviewStatus::ZoneEnroll);
-            return interviewRequest(id, device);
+    if (m_configurations.contains(device->ieeeAddress()))
+        configurationFinished(device, m_configurations.value(device->ieeeAddress()));
+}
 
-        case InterviewStatus::ZoneEnroll:
+Request ZigBee::findRequest(const Device &device, quint8 transactionId)
+{
+    auto it = m_transactions.find(qMakePair(device->ieeeAddress(), transactionId));
+    Request request = it != m_transactions.end() ? m_requests.value(it.value()) : Request();
 
-            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
-            {
-                if (!it.value()->inClusters().contains(CLUSTER_IAS_ZONE))
-                    continue;
+    if (request.isNull() || (request->status() == RequestStatus::Finished && request->deadline() <= QDateTime::currentMSecsSinceEpoch()))
+        return Request();
 
-                switch (it.value()->zoneStatus())
-                {
-                    case ZoneStatus::Unknown:
-                    {
-                        if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, readAttributesRequest(id, 0x0000, {0x0000, 0x0001, 0x0010})))
-                        {
-                            interviewError(device, "read current IAS zone status request failed");
-                            return false;
-                        }
+    return request;
+}
 
-                        return true;
-                    }
+quint8 ZigBee::adapterTag(void)
+{
+    for (int i = 0; i < 0xFF && (m_tags.contains(m_adapterTag) || m_reservedTags.contains(m_adapterTag)); i++)
+        m_adapterTag++;
 
-                    case ZoneStatus::SetAddress:
-                    {
-                        quint64 ieeeAddress;
+    m_descriptorTags.remove(m_adapterTag);
+    return m_adapterTag++;
+}
 
-                        memcpy(&ieeeAddress, m_adapter->ieeeAddress().constData(), sizeof(ieeeAddress));
-                        ieeeAddress = qToLittleEndian(qFromBigEndian(ieeeAddress));
+bool ZigBee::pendingTransaction(const Request &request)
+{
+    if (request->type() != RequestType::Data)
+        return false;
 
-                        if (!m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, writeAttributeRequest(id, 0x0000, 0x0010, DATA_TYPE_IEEE_ADDRESS, QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)))))
-                        {
-                            interviewError(device, "write IAS zone CIE address request failed");
-                            return false;
-                        }
+    const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+    auto it = m_transactions.find(qMakePair(data->device()->ieeeAddress(), data->transactionId()));
 
-                        return true;
-                    }
+    return it != m_transactions.end() && m_requests.value(it.value()) == request;
+}
 
-                    case ZoneStatus::Enroll:
-                    {
-                        iasZoneEnrollResponseStruct payload;
+bool ZigBee::reserveTag(quint8 &tag)
+{
+    if (!tagAvailable())
+        return false;
 
-                        payload.responseCode = 0x00;
-                        payload.zoneId = IAS_ZONE_ID;
+    tag = adapterTag();
+    m_reservedTags.insert(tag);
+    return true;
+}
 
-                        m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, id, 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload)));
-                        m_adapter->unicastRequest(id, device->networkAddress(), 0x01, it.key(), CLUSTER_IAS_ZONE, readAttributesRequest(id, 0x0000, {0x0000, 0x0010}));
-                        break;
-                    }
+bool ZigBee::tagAvailable(void)
+{
+    return m_tags.count() + m_reservedTags.count() <= 0xFF;
+}
 
-                    case ZoneStatus::Enrolled:
-                    {
-                        logInfo << device << it.value() << "IAS zone enrolled";
-                        break;
-                    }
-                }
-            }
+void ZigBee::releaseTag(quint8 tag)
+{
+    QTimer::singleShot(NETWORK_REQUEST_TIMEOUT, this, [this, tag] () { m_reservedTags.remove(tag); });
+}
 
-            interviewFinished(device);
-            return true;
+void ZigBee::releaseTransaction(const Request &request)
+{
+    if (!pendingTransaction(request))
+        return;
 
-        default:
-            return false;
-    }
+    const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+    m_transactions.remove(qMakePair(data->device()->ieeeAddress(), data->transactionId()));
 }
 
-bool ZigBee::interviewQuirks(const Device &device)
+void ZigBee::releasePending(const Request &request)
 {
-    Endpoint endpoint = m_devices->endpoint(device, 0x01);
+    QByteArray ieeeAddress;
+
+    if (request->type() != RequestType::Data)
+        return;
+
+    ieeeAddress = qvariant_cast <DataRequest> (request->data())->device()->ieeeAddress();
 
-    if (device->options().value("ikeaCover").toBool())
+    for (auto it = m_actionRequests.lowerBound(qMakePair(ieeeAddress, QString())); it != m_actionRequests.end() && it.key().first == ieeeAddress; )
     {
-        quint32 value = qToLittleEndian <quint32> (172800);
+        if (m_requests.value(it.value()) != request)
+        {
+            it++;
+            continue;
+        }
 
-        if (device->firmware().split('.').first().toInt() >= 24 && !dataRequest(endpoint, CLUSTER_POLL_CONTROL, writeAttributeRequest(m_requestId, 0x0000, 0x0000, DATA_TYPE_32BIT_UNSIGNED, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))), "polling configuration request"))
-            return false;
+        it = m_actionRequests.erase(it);
+    }
+
+    for (auto it = m_readRequests.lowerBound(qMakePair(ieeeAddress, static_cast <quint64> (0))); it != m_readRequests.end() && it.key().first == ieeeAddress; )
+    {
+        if (m_requests.value(it.value()) != request)
+        {
+            it++;
+            continue;
+        }
+
+        it = m_readRequests.erase(it);
+    }
+}
+
+void ZigBee::readAttributes(const Device &device, quint8 endpointId, quint16 clusterId, quint16 manufacturerCode, const QList <quint16> &attributes, RequestPriority priority, const QString &name)
+{
+    QPair <QByteArray, quint64> key(device->ieeeAddress(), static_cast <quint64> (endpointId) << 32 | static_cast <quint32> (clusterId) << 16 | manufacturerCode);
+    auto it = m_readRequests.find(key);
+
+    if (it != m_readRequests.end())
+    {
+        const Request &request = m_requests.value(it.value());
+
+        if (!request.isNull() && request->status() == RequestStatus::Pending && request->priority() == priority)
+        {
+            const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+            QByteArray payload = data->data();
+            QList <quint16> list;
+
+            for (int i = payload.at(0) & FC_MANUFACTURER_SPECIFIC ? 5 : 3; i + 1 < payload.length(); i += 2)
+            {
+                quint16 attributeId;
+                memcpy(&attributeId, payload.constData() + i, sizeof(attributeId));
+                list.append(qFromLittleEndian(attributeId));
+            }
+
+            for (int i = 0; i < attributes.count(); i++)
+            {
+                if (list.contains(attributes.at(i)))
+                    continue;
+
+                list.append(attributes.at(i));
+            }
+
+            if (list.count() <= READ_ATTRIBUTES_LIMIT)
+            {
+                logDebug(m_debug) << device << "endpoint" << QString::asprintf("0x%02x", endpointId) << "cluster" << QString::asprintf("0x%04x", clusterId) << "read request" << it.value() << "merged";
+                data->setData(readAttributesRequest(data->transactionId(), manufacturerCode, list));
+                return;
+            }
+        }
+    }
+
+    m_readRequests.insert(key, enqueueRequest(device, endpointId, clusterId, readAttributesRequest(device->nextTransactionId(), manufacturerCode, attributes), priority, name, false, manufacturerCode));
+}
+
+void ZigBee::adapterRequest(quint8 id, const Device &device, const std::function <bool (void)> &request)
+{
+    QByteArray ieeeAddress = device->ieeeAddress();
+    bool extendedTimeout = device->batteryPowered();
+
+    m_adapter->enqueueCall([this, id, ieeeAddress, extendedTimeout, request] ()
+    {
+        quint8 status;
+
+        m_adapter->setRequestParameters(ieeeAddress, extendedTimeout);
+
+        if (request())
+            return;
+
+        status = m_adapter->replyStatus() ? m_adapter->replyStatus() : 0xFF;
+        QMetaObject::invokeMethod(this, [this, id, status] () { requestFinished(id, status); });
+    });
+}
+
+bool ZigBee::adapterCall(const std::function <bool (void)> &call)
+{
+    struct CallState { QSemaphore semaphore; QAtomicInt state; bool result = false; };
+    QSharedPointer <CallState> data(new CallState);
+
+    m_adapter->enqueueCall([data, call] ()
+    {
+        if (!data->state.testAndSetOrdered(0, 1))
+            return;
+
+        data->result = call();
+        data->semaphore.release();
+    });
+
+    if (data->semaphore.tryAcquire(1, ADAPTER_CALL_TIMEOUT))
+        return data->result;
+
+    if (data->state.testAndSetOrdered(0, 2))
+        return false;
+
+    data->semaphore.acquire(); // call is already running and may use caller stack
+    return data->result;
+}
+
+void ZigBee::requestCallback(const Request &request, bool success)
+{
+    RequestCallback callback = request->callback();
+
+    if (request->type() == RequestType::Data && (!success || !qvariant_cast <DataRequest> (request->data())->reply()))
+        releaseTransaction(request);
+
+    releasePending(request);
+
+    if (!m_requestTimer->isActive() && !m_interPanLock)
+    {
+        for (auto it = m_queues.begin(); it != m_queues.end(); it++)
+        {
+            if (it.value().isEmpty())
+                continue;
+
+            m_requestTimer->start();
+            break;
+        }
+    }
+
+    if (!callback)
+        return;
+
+    callback(success);
+}
+
+void ZigBee::requestTimeout(const Request &request)
+{
+    if (request->status() != RequestStatus::Sent)
+        return;
+
+    switch (request->type())
+    {
+        case RequestType::Data:
+        {
+            const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+            QString name = !data->name().isEmpty() ? data->name() : "data request";
+            logWarning << data->device() << name.toUtf8().constData() << "timed out";
+            emit deviceEvent(data->device().data(), Event::requestFailed, {{"request", name}, {"retries", request->retries()}});
+            break;
+        }
+
+        case RequestType::Binding:
+        {
+            const BindingRequest &binding = qvariant_cast <BindingRequest> (request->data());
+            logWarning << binding->endpoint()->device() << binding->endpoint() << "cluster" << QString::asprintf("0x%04x", binding->clusterId()) << binding->name().toUtf8().constData() << "timed out";
+            emit deviceEvent(binding->endpoint()->device().data(), Event::requestFailed, {{"request", binding->name()}, {"retries", request->retries()}});
+            break;
+        }
+
+        case RequestType::Leave:
+        {
+            const Device &device = qvariant_cast <Device> (request->data());
+            logWarning << device << "leave request timed out";
+            emit deviceEvent(device.data(), Event::requestFailed, {{"request", "leave request"}, {"retries", request->retries()}});
+            break;
+        }
+
+        case RequestType::LQI:
+        {
+            const Device &device = qvariant_cast <Device> (request->data());
+            logWarning << device << "LQI request timed out";
+            emit deviceEvent(device.data(), Event::requestFailed, {{"request", "LQI request"}, {"retries", request->retries()}});
+            device->setLqiRequestPending(false);
+            storeNeighbors();
+            break;
+        }
+
+        case RequestType::Interview:
+        {
+            const Device &device = qvariant_cast <Device> (request->data());
+            emit deviceEvent(device.data(), Event::requestFailed, {{"request", "interview request"}, {"retries", request->retries()}});
+            interviewError(device, "interview request timed out");
+            break;
+        }
+    }
+
+    request->setStatus(RequestStatus::Aborted);
+    requestCallback(request, false);
+}
+
+bool ZigBee::idempotentRequest(const Request &request)
+{
+    switch (request->type())
+    {
+        case RequestType::Data: return request->priority() != RequestPriority::Response && qvariant_cast <DataRequest> (request->data())->idempotent();
+        case RequestType::Binding: return true;
+        default: return false;
+    }
+}
+
+void ZigBee::retryRequest(quint32 id, const Request &request)
+{
+    Device device = requestDevice(request);
+    auto tag = m_tags.find(request->tag());
+    int delay = qMin(m_requestBackoff << qMin(device->requestFailures(), 8), REQUEST_MAX_BACKOFF);
+
+    if (tag != m_tags.end() && tag.value() == id)
+    {
+        m_queues[request->priority()].release();
+        m_tags.erase(tag);
+    }
+
+    if (request->type() == RequestType::Data)
+    {
+        const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+
+        releaseTransaction(request);
+        data->setTransactionId(device->nextTransactionId());
+
+        if (data->reply())
+            m_transactions.insert(qMakePair(device->ieeeAddress(), data->transactionId()), id);
+    }
+
+    request->setRetries(request->retries() + 1);
+    request->setStatus(RequestStatus::Pending);
+
+    logDebug(m_debug) << device << "request" << id << "timed out, retry" << request->retries() << "scheduled in" << delay << "ms";
+
+    QTimer::singleShot(delay, this, [this, device, id] ()
+    {
+        const Request &request = m_requests.value(id);
+
+        if (request.isNull() || request->status() != RequestStatus::Pending || holdRequest(device, id))
+            return;
+
+        m_queues[request->priority()].enqueue(device->ieeeAddress(), id);
+
+        if (!m_requestTimer->isActive() && !m_interPanLock)
+            m_requestTimer->start();
+    });
+}
+
+void ZigBee::runSteps(QList <RequestStep> steps, const RequestCallback &callback)
+{
+    RequestStep step;
+
+    if (steps.isEmpty())
+    {
+        callback(true);
+        return;
+    }
+
+    step = steps.takeFirst();
+    step([this, steps, callback] (bool success)
+    {
+        if (!success)
+        {
+            callback(false);
+            return;
+        }
+
+        runSteps(steps, callback);
+    });
+}
+
+bool ZigBee::interviewRequest(quint8 id, const Device &device)
+{
+    quint16 networkAddress = device->networkAddress();
+
+    switch (device->interviewStatus())
+    {
+        case InterviewStatus::NodeDescriptor:
+
+            adapterRequest(id, device, [this, id, networkAddress] () { return m_adapter->zdoRequest(id, networkAddress, ZDO_NODE_DESCRIPTOR_REQUEST); });
+            return true;
+
+        case InterviewStatus::ActiveEndpoints:
+
+            adapterRequest(id, device, [this, id, networkAddress] () { return m_adapter->zdoRequest(id, networkAddress, ZDO_ACTIVE_ENDPOINTS_REQUEST); });
+            return true;
+
+        case InterviewStatus::SimpleDescriptors:
+        {
+            bool pending = false;
+
+            for (auto it = m_descriptorTags.begin(); it != m_descriptorTags.end(); )
+            {
+                if (it.value().first != device->ieeeAddress())
+                {
+                    it++;
+                    continue;
+                }
+
+                it = m_descriptorTags.erase(it);
+            }
+
+            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+            {
+                QByteArray request(1, static_cast <char> (it.key()));
+                quint8 tag;
+
+                if (it.value()->descriptorStatus() != DescriptorStatus::Pending)
+                    continue;
+
+                if (!pending)
+                    tag = id;
+                else if (!reserveTag(tag))
+                    break;
+
+                m_descriptorTags.insert(tag, qMakePair(device->ieeeAddress(), it.key()));
+                adapterRequest(tag, device, [this, tag, networkAddress, request] () { return m_adapter->zdoRequest(tag, networkAddress, ZDO_SIMPLE_DESCRIPTOR_REQUEST, request); });
+
+                if (tag != id)
+                    releaseTag(tag);
+
+                pending = true;
+            }
+
+            if (pending)
+                return true;
+
+            device->setInterviewStatus(InterviewStatus::BasicAttributes);
+            return interviewRequest(id, device);
+        }
+
+        case InterviewStatus::Fingerprint:
+        case InterviewStatus::BasicAttributes:
+
+            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+            {
+                quint8 endpointId = it.key();
+                QByteArray request;
+
+                if (!it.value()->inClusters().contains(CLUSTER_BASIC))
+                    continue;
+
+                request = readAttributesRequest(device->nextTransactionId(), 0x0000, {0x0001, 0x0004, 0x0005, 0x0007, 0x4000});
+                adapterRequest(id, device, [this, id, networkAddress, endpointId, request] () { return m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_BASIC, request); });
+                return true;
+            }
+
+            interviewError(device, "no endpoint contains basic cluster");
+            return false;
+
+        case InterviewStatus::ApplicationVersion ... InterviewStatus::FirmwareVersion:
+
+            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+            {
+                quint8 endpointId = it.key();
+                quint16 attributeId;
+                QByteArray request;
+
+                if (!it.value()->inClusters().contains(CLUSTER_BASIC))
+                    continue;
+
+                switch (device->interviewStatus())
+                {
+                    case InterviewStatus::ApplicationVersion: attributeId = 0x0001; break;
+                    case InterviewStatus::ManufacturerName: attributeId = 0x0004; break;
+                    case InterviewStatus::ModelName: attributeId = 0x0005; break;
+                    case InterviewStatus::PowerSource: attributeId = 0x0007; break;
+                    case InterviewStatus::FirmwareVersion: attributeId = 0x4000; break;
+                    default: return false;
+                }
+
+                request = readAttributesRequest(device->nextTransactionId(), 0x0000, {attributeId});
+                adapterRequest(id, device, [this, id, networkAddress, endpointId, request] () { return m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_BASIC, request); });
+                return true;
+            }
+
+            interviewError(device, "no endpoint contains basic cluster");
+            return false;
+
+        case InterviewStatus::ColorCapabilities:
+
+            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+            {
+                quint8 endpointId = it.key();
+                QByteArray request;
+
+                if (device->batteryPowered() || !it.value()->inClusters().contains(CLUSTER_COLOR_CONTROL) || it.value()->colorCapabilities() != 0xFFFF)
+                    continue;
+
+                request = readAttributesRequest(device->nextTransactionId(), 0x0000, {0x400A});
+                adapterRequest(id, device, [this, id, networkAddress, endpointId, request] () { return m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_COLOR_CONTROL, request); });
+                return true;
+            }
+
+            device->setInterviewStatus(InterviewStatus::ZoneEnroll);
+            return interviewRequest(id, device);
+
+        case InterviewStatus::ZoneEnroll:
+
+            for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+            {
+                quint8 endpointId = it.key();
+
+                if (!it.value()->inClusters().contains(CLUSTER_IAS_ZONE))
+                    continue;
+
+                switch (it.value()->zoneStatus())
+                {
+                    case ZoneStatus::Unknown:
+                    {
+                        QByteArray request = readAttributesRequest(device->nextTransactionId(), 0x0000, {0x0000, 0x0001, 0x0010});
+                        adapterRequest(id, device, [this, id, networkAddress, endpointId, request] () { return m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_IAS_ZONE, request); });
+                        return true;
+                    }
+
+                    case ZoneStatus::SetAddress:
+                    {
+                        quint64 ieeeAddress;
+                        QByteArray request;
+
+                        memcpy(&ieeeAddress, m_ieeeAddress.constData(), sizeof(ieeeAddress));
+                        ieeeAddress = qToLittleEndian(qFromBigEndian(ieeeAddress));
+
+                        request = writeAttributeRequest(device->nextTransactionId(), 0x0000, 0x0010, DATA_TYPE_IEEE_ADDRESS, QByteArray(reinterpret_cast <char*> (&ieeeAddress), sizeof(ieeeAddress)));
+                        adapterRequest(id, device, [this, id, networkAddress, endpointId, request] () { return m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_IAS_ZONE, request); });
+                        return true;
+                    }
+
+                    case ZoneStatus::Enroll:
+                    {
+                        iasZoneEnrollResponseStruct payload;
+                        QByteArray response, request;
+
+                        payload.responseCode = 0x00;
+                        payload.zoneId = IAS_ZONE_ID;
+
+                        response = zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, device->nextTransactionId(), 0x00).append(reinterpret_cast <char*> (&payload), sizeof(payload));
+                        request = readAttributesRequest(device->nextTransactionId(), 0x0000, {0x0000, 0x0010});
+
+                        adapterRequest(id, device, [this, id, networkAddress, endpointId, response, request] ()
+                        {
+                            m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_IAS_ZONE, response);
+                            m_adapter->unicastRequest(id, networkAddress, 0x01, endpointId, CLUSTER_IAS_ZONE, request);
+                            return true;
+                        });
+                        break;
+                    }
+
+                    case ZoneStatus::Enrolled:
+                    {
+                        logInfo << device << it.value() << "IAS zone enrolled";
+                        break;
+                    }
+                }
+            }
+
+            interviewFinished(device);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void ZigBee::interviewQuirks(const Device &device, QList <RequestStep> &steps)
+{
+    Endpoint endpoint = m_devices->endpoint(device, 0x01);
+
+    if (device->options().value("ikeaCover").toBool() && device->firmware().split('.').first().toInt() >= 24)
+    {
+        steps.append([this, endpoint] (const RequestCallback &callback)
+        {
+            quint32 value = qToLittleEndian <quint32> (172800);
+            dataRequest(endpoint, CLUSTER_POLL_CONTROL, writeAttributeRequest(endpoint->device()->nextTransactionId(), 0x0000, 0x0000, DATA_TYPE_32BIT_UNSIGNED, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))), "polling configuration request", callback);
+        });
     }
 
     if (device->options().value("ikeaRemote").toBool())
     {
         QList <QString> list = device->firmware().split('.');
-        quint16 groupId = qToLittleEndian <quint16> (IKEA_GROUP);
         bool check = list.value(0).toInt() < 2 || (list.value(0).toInt() == 2 && list.value(1).toInt() < 3) || (list.value(0).toInt() == 2 && list.value(1).toInt() == 3 && list.value(2).toInt() < 75);
 
-        if (check ? !bindRequest(endpoint, CLUSTER_ON_OFF, QByteArray(reinterpret_cast <char*> (&groupId), sizeof(groupId)), 0xFF) : !bindRequest(endpoint, CLUSTER_ON_OFF))
-            return false;
+        steps.append([this, endpoint, check] (const RequestCallback &callback)
+        {
+            quint16 groupId = qToLittleEndian <quint16> (IKEA_GROUP);
+            bindRequest(endpoint, CLUSTER_ON_OFF, check ? QByteArray(reinterpret_cast <char*> (&groupId), sizeof(groupId)) : QByteArray(), check ? 0xFF : 0x00, false, false, callback);
+        });
     }
 
-    if (device->modelName() == "lumi.switch.n3acn3" && !dataRequest(endpoint, CLUSTER_LUMI, writeAttributeRequest(m_requestId, MANUFACTURER_CODE_LUMI, 0x0200, DATA_TYPE_8BIT_UNSIGNED, QByteArray(1, 0x01)), "magic request"))
-        return false;
+    if (device->modelName() == "lumi.switch.n3acn3")
+        steps.append([this, endpoint] (const RequestCallback &callback) { dataRequest(endpoint, CLUSTER_LUMI, writeAttributeRequest(endpoint->device()->nextTransactionId(), MANUFACTURER_CODE_LUMI, 0x0200, DATA_TYPE_8BIT_UNSIGNED, QByteArray(1, 0x01)), "magic request", callback); });
 
-    if (device->options().value("tuyaMagic").toBool() && !dataRequest(endpoint, CLUSTER_BASIC, readAttributesRequest(m_requestId, 0x0000, {0x0004, 0x0000, 0x0001, 0x0005, 0x0007, 0xFFFE}), "magic request"))
-        return false;
+    if (device->options().value("tuyaMagic").toBool())
+        steps.append([this, endpoint] (const RequestCallback &callback) { dataRequest(endpoint, CLUSTER_BASIC, readAttributesRequest(endpoint->device()->nextTransactionId(), 0x0000, {0x0004, 0x0000, 0x0001, 0x0005, 0x0007, 0xFFFE}), "magic request", callback); });
 
-    if (device->options().value("tuyaDataQuery").toBool() && !dataRequest(endpoint, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, 0x03), "data query request"))
-        return false;
+    if (device->options().value("tuyaDataQuery").toBool())
+        steps.append([this, endpoint] (const RequestCallback &callback) { dataRequest(endpoint, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, endpoint->device()->nextTransactionId(), 0x03), "data query request", callback); });
 
     if (device->manufacturerName() == "_TZ3000_xwh1e22x")
     {
@@ -633,11 +1268,8 @@ bool ZigBee::interviewQuirks(const Device &device)
             payload.append(reinterpret_cast <char*> (&value), sizeof(value)).append(1, i + 1);
         }
 
-        if (!dataRequest(endpoint, CLUSTER_GROUPS, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0xF0).append(payload), "groups setup request"))
-            return false;
+        steps.append([this, endpoint, payload] (const RequestCallback &callback) { dataRequest(endpoint, CLUSTER_GROUPS, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, endpoint->device()->nextTransactionId(), 0xF0).append(payload), "groups setup request", callback); });
     }
-
-    return true;
 }
 
 void ZigBee::interviewDevice(const Device &device)
@@ -649,11 +1281,50 @@ void ZigBee::interviewDevice(const Device &device)
     device->timer()->setSingleShot(true);
     device->timer()->start(NETWORK_REQUEST_TIMEOUT);
 
-    enqueueRequest(device, RequestType::Interview);
+    enqueueRequest(device, RequestType::Interview, RequestPriority::Interview);
+}
+
+void ZigBee::descriptorFailed(quint8 id, quint8 status)
+{
+    auto it = m_descriptorTags.find(id);
+    Device device;
+    Endpoint endpoint;
+
+    if (it == m_descriptorTags.end())
+        return;
+
+    device = m_devices->value(it.value().first);
+
+    if (!device.isNull())
+        endpoint = device->endpoints().value(it.value().second);
+
+    m_descriptorTags.erase(it);
+
+    if (endpoint.isNull() || device->interviewStatus() != InterviewStatus::SimpleDescriptors || endpoint->descriptorStatus() != DescriptorStatus::Pending)
+        return;
+
+    logInfo << device << endpoint << "simple descriptor unavailable, status code:" << QString::asprintf("0x%02x", status);
+    endpoint->setDescriptorStatus(DescriptorStatus::Received);
+
+    if (pendingDescriptors(device))
+        return;
+
+    interviewDevice(device);
+}
+
+bool ZigBee::pendingDescriptors(const Device &device)
+{
+    for (auto it = m_descriptorTags.begin(); it != m_descriptorTags.end(); it++)
+        if (it.value().first == device->ieeeAddress())
+            return true;
+
+    return false;
 }
 
 void ZigBee::interviewFinished(const Device &device)
 {
+    QList <RequestStep> steps;
+
     device->timer()->stop();
 
     logInfo << device << "manufacturer name is" << device->manufacturerName() << "and model name is" << device->modelName();
@@ -665,19 +1336,26 @@ void ZigBee::interviewFinished(const Device &device)
     if (!device->description().isEmpty())
         logInfo << device << "identified as" << device->description();
 
-    if (!interviewQuirks(device) || !configureDevice(device))
-    {
-        logWarning << device << "interview finished with errors";
-        emit deviceEvent(device.data(), Event::interviewError);
-    }
-    else
+    interviewQuirks(device, steps);
+    steps.append([this, device] (const RequestCallback &callback) { configureDevice(device, callback); });
+
+    runSteps(steps, [this, device] (bool success)
     {
-        device->setInterviewStatus(InterviewStatus::Finished);
-        logInfo << device << "interview finished successfully";
-        emit deviceEvent(device.data(), Event::interviewFinished);
-    }
+        if (!success)
+        {
+            logWarning << device << "interview finished with errors";
+            emit deviceEvent(device.data(), Event::interviewError);
+        }
+        else
+        {
+            device->setInterviewStatus(InterviewStatus::Finished);
+            storeFingerprint(device);
+            logInfo << device << "interview finished successfully";
+            emit deviceEvent(device.data(), Event::interviewFinished);
+        }
 
-    m_devices->storeDatabase();
+        m_devices->storeDatabase();
+    });
 }
 
 void ZigBee::interviewError(const Device &device, const QString &reason)
@@ -691,53 +1369,127 @@ void ZigBee::interviewError(const Device &device, const QString &reason)
     device->timer()->stop();
 }
 
-bool ZigBee::configureDevice(const Device &device)
+QString ZigBee::fingerprint(const Device &device, bool node)
+{
+    QString key = QString::asprintf("%04x:%d:", device->manufacturerCode(), static_cast <int> (device->logicalType()));
+    return node ? key : key.append(QList <QString> {device->manufacturerName(), device->modelName(), device->firmware()}.join(':'));
+}
+
+void ZigBee::storeFingerprint(const Device &device)
 {
+    if (device->logicalType() == LogicalType::Coordinator || device->modelName().isEmpty() || device->endpoints().isEmpty())
+        return;
+
+    m_fingerprints.insert(fingerprint(device), device);
+}
+
+bool ZigBee::restoreFingerprint(const Device &device)
+{
+    auto it = m_fingerprints.find(fingerprint(device));
+
+    if (it == m_fingerprints.end() || it.value() == device)
+        return false;
+
+    for (auto item = it.value()->endpoints().begin(); item != it.value()->endpoints().end(); item++)
+    {
+        Endpoint endpoint = m_devices->endpoint(device, item.key());
+
+        endpoint->setProfileId(item.value()->profileId());
+        endpoint->setDeviceId(item.value()->deviceId());
+        endpoint->setColorCapabilities(item.value()->colorCapabilities());
+        endpoint->setDescriptorStatus(DescriptorStatus::Received);
+
+        endpoint->inClusters() = item.value()->inClusters();
+        endpoint->outClusters() = item.value()->outClusters();
+    }
+
+    logInfo << device << "matches" << it.value() << "fingerprint, endpoint layout restored";
+    return true;
+}
+
+void ZigBee::configureDevice(const Device &device, const RequestCallback &callback)
+{
+    QList <RequestStep> steps;
     bool groups = false;
+    quint32 id;
 
-    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+    if (m_configurations.count() >= CONFIGURATION_LIMIT || m_configurations.contains(device->ieeeAddress()))
     {
-        for (int i = 0; i < it.value()->bindings().count(); i++)
-        {
-            const Binding &binding = it.value()->bindings().at(i);
+        m_configurationQueue.append(qMakePair(device, callback));
+        return;
+    }
 
-            if (bindRequest(it.value(), binding->clusterId(), binding->address(), binding->endpointId()))
-                continue;
+    for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
+    {
+        const Endpoint &endpoint = it.value();
 
-            return false;
+        for (int i = 0; i < endpoint->bindings().count(); i++)
+        {
+            const Binding &binding = endpoint->bindings().at(i);
+            steps.append([this, endpoint, binding] (const RequestCallback &callback) { bindRequest(endpoint, binding->clusterId(), binding->address(), binding->endpointId(), false, false, callback); });
         }
     }
 
     for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
     {
-        if (!it.value()->groups().isEmpty())
+        const Endpoint &endpoint = it.value();
+
+        if (!endpoint->groups().isEmpty())
             groups = true;
 
-        for (int i = 0; i < it.value()->reportings().count(); i++)
+        for (int i = 0; i < endpoint->reportings().count(); i++)
         {
-            const Reporting &reporting = it.value()->reportings().at(i);
+            const Reporting &reporting = endpoint->reportings().at(i);
+            steps.append([this, endpoint, reporting] (const RequestCallback &callback) { configureReporting(endpoint, reporting, callback); });
+        }
+    }
 
-            if (configureReporting(it.value(), reporting))
-                continue;
+    id = m_configurationId++;
+    m_configurations.insert(device->ieeeAddress(), id);
+    QTimer::singleShot(CONFIGURATION_TIMEOUT, this, [this, device, id] () { configurationFinished(device, id); });
 
-            return false;
+    runSteps(steps, [this, device, groups, callback, id] (bool success)
+    {
+        configurationFinished(device, id);
+
+        if (success && groups && !device->batteryPowered())
+        {
+            logInfo << device << "groups will be restored in 10 seconds...";
+            QTimer::singleShot(10000, this, [this, device] () { restoreGroups(device); });
         }
-    }
 
-    if (groups && !device->batteryPowered())
+        callback(success);
+    });
+}
+
+void ZigBee::configurationFinished(const Device &device, quint32 id)
+{
+    auto it = m_configurations.find(device->ieeeAddress());
+
+    if (it == m_configurations.end() || it.value() != id)
+        return;
+
+    m_configurations.erase(it);
+
+    for (int i = 0; i < m_configurationQueue.count(); i++)
     {
-        logInfo << device << "groups will be restored in 10 seconds...";
-        QTimer::singleShot(10000, this, [this, device] () { restoreGroups(device); });
-    }
+        QPair <Device, RequestCallback> item;
 
-    return true;
+        if (m_configurations.contains(m_configurationQueue.at(i).first->ieeeAddress()))
+            continue;
+
+        item = m_configurationQueue.takeAt(i);
+        configureDevice(item.first, item.second);
+        break;
+    }
 }
 
-bool ZigBee::configureReporting(const Endpoint &endpoint, const Reporting &reporting)
+void ZigBee::configureReporting(const Endpoint &endpoint, const Reporting &reporting, const RequestCallback &callback)
 {
     const Device &device = endpoint->device();
     QMap <QString, QVariant> options = device->options().value(device->options().contains("reporting") ? "reporting" : QString(reporting->name()).append("Reporting")).toMap();
-    QByteArray request = zclHeader(0x00, m_requestId, CMD_CONFIGURE_REPORTING);
+    QByteArray payload = zclHeader(0x00, device->nextTransactionId(), CMD_CONFIGURE_REPORTING);
+    DataRequest request;
 
     for (int i = 0; i < reporting->attributes().count(); i++)
     {
@@ -750,48 +1502,27 @@ bool ZigBee::configureReporting(const Endpoint &endpoint, const Reporting &repor
         item.maxInterval = qToLittleEndian <quint16> (options.contains("maxInterval") ? options.value("maxInterval").toInt() : reporting->maxInterval());
         item.valueChange = qToLittleEndian <quint64> (options.contains("valueChange") ? options.value("valueChange").toInt() : reporting->valueChange());
 
-        request.append(reinterpret_cast <char*> (&item), sizeof(item) - sizeof(item.valueChange) + zclDataSize(item.dataType));
-    }
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-    m_replyId = m_requestId;
-    m_replyReceived = false;
-
-    if (!m_adapter->unicastRequest(m_requestId, device->networkAddress(), 0x01, endpoint->id(), reporting->clusterId(), request))
-    {
-        logWarning << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request aborted";
-        return false;
-    }
-
-    if (!m_replyReceived && !m_adapter->waitForSignal(this, SIGNAL(replyReceived()), NETWORK_REQUEST_TIMEOUT))
-    {
-        logWarning << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request timed out";
-        return false;
+        payload.append(reinterpret_cast <char*> (&item), sizeof(item) - sizeof(item.valueChange) + zclDataSize(item.dataType));
     }
 
-    m_requestId++;
+    request = DataRequest(new DataRequestObject(device, endpoint->id(), reporting->clusterId(), payload, QString("%1 reporting configuration request").arg(reporting->name()), false, 0, Action()));
 
-    if (m_requestStatus)
+    enqueueRequest(Request(new RequestObject(QVariant::fromValue(request), RequestType::Data, RequestPriority::Configuration, [this, device, endpoint, reporting, callback] (bool success)
     {
-        logWarning << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request failed, status code:" << QString::asprintf("0x%02x", m_requestStatus);
-        return false;
-    }
+        if (success && reporting->name() == "battery")
+            readAttributes(device, endpoint->id(), CLUSTER_POWER_CONFIGURATION, 0x0000, reporting->attributes(), RequestPriority::Configuration, "battery status request");
 
-    if (reporting->name() == "battery")
-        enqueueRequest(device, endpoint->id(), CLUSTER_POWER_CONFIGURATION, readAttributesRequest(m_requestId, 0x0000, reporting->attributes()), "battery status request");
+        if (!callback)
+            return;
 
-    logInfo << device << endpoint << reporting->name().toUtf8().constData() << "reporting configuration request finished successfully";
-    return true;
+        callback(success);
+    })));
 }
 
-bool ZigBee::bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address, quint8 dstEndpointId, bool unbind, bool manual)
+void ZigBee::bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address, quint8 dstEndpointId, bool unbind, bool manual, const RequestCallback &callback)
 {
-    const Device &device = endpoint->device();
     QString name = unbind ? "unbinding from " : "binding to ";
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-    m_replyId = m_requestId;
-    m_replyReceived = false;
+    BindingRequest request;
 
     switch (address.length())
     {
@@ -801,211 +1532,131 @@ bool ZigBee::bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByt
         default:
         {
             const Device &device = m_devices->value(address);
-            name.append(QString::asprintf("device \"%s\" endpoint \"0x%02x\"", device.isNull() ? address.toHex(':').constData() : device->name().toUtf8().constData(), dstEndpointId ? dstEndpointId : 0x01)); break;
-            break;
-        }
-    }
-
-    if (!m_adapter->bindRequest(m_requestId, device->networkAddress(), endpoint->id(), clusterId, address, dstEndpointId, unbind))
-    {
-        logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "request aborted";
-        return false;
-    }
-
-    if (!m_replyReceived && !m_adapter->waitForSignal(this, SIGNAL(replyReceived()), NETWORK_REQUEST_TIMEOUT))
-    {
-        logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "timed out";
-        return false;
-    }
-
-    m_requestId++;
-
-    if (m_requestStatus)
-    {
-        logWarning << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", m_requestStatus);
-        return false;
-    }
-
-    logInfo << device << endpoint << "cluster" << QString::asprintf("0x%04x", clusterId) << name.toUtf8().constData() << "finished successfully";
-
-    if (manual)
-    {
-        Binding binding(new BindingObject(clusterId, address, dstEndpointId));
-        bool check = true;
-
-        for (int i = 0; i < endpoint->bindings().count(); i++)
-        {
-            const Binding &item = endpoint->bindings().at(i);
-
-            if (!item->name().isEmpty() || item->clusterId() != binding->clusterId() || item->address() != binding->address() || item->endpointId() != binding->endpointId())
-                continue;
-
-            if (unbind)
-            {
-                endpoint->bindings().removeAt(i);
-                m_devices->storeDatabase();
-            }
-
-            check = false;
+            name.append(QString::asprintf("device \"%s\" endpoint \"0x%02x\"", device.isNull() ? address.toHex(':').constData() : device->name().toUtf8().constData(), dstEndpointId ? dstEndpointId : 0x01));
             break;
         }
-
-        if (check)
-        {
-            endpoint->bindings().append(binding);
-            m_devices->storeDatabase();
-        }
-    }
-
-    return true;
-}
-
-bool ZigBee::groupRequest(const Endpoint &endpoint, quint16 groupId, bool removeAll, bool remove)
-{
-    const Device &device = endpoint->device();
-    QByteArray request;
-    QString name;
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-
-    if (removeAll)
-    {
-        m_replyId = m_requestId;
-        m_replyReceived = false;
-        request = zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, 0x04);
-        name = "remove all groups request";
-    }
-    else
-    {
-        m_groupRequestFinished = false;
-        groupId = qToLittleEndian(groupId);
-        request = zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, remove ? 0x03 : 0x00).append(reinterpret_cast <char*> (&groupId), sizeof(groupId)).append(remove ? 0 : 1, 0x00);
-        name = QString("%1 group request").arg(remove ? "remove" : "add");
     }
 
-    if (!m_adapter->unicastRequest(m_requestId, device->networkAddress(), 0x01, endpoint->id(), CLUSTER_GROUPS, request))
-    {
-        logWarning << device << endpoint << name.toUtf8().constData() << "aborted";
-        return false;
-    }
+    request = BindingRequest(new BindingRequestObject(endpoint, clusterId, address, dstEndpointId, unbind, name));
 
-    if (removeAll ? !m_replyReceived : !m_groupRequestFinished && !m_adapter->waitForSignal(this, removeAll ? SIGNAL(replyReceived()) : SIGNAL(groupRequestFinished()), NETWORK_REQUEST_TIMEOUT))
+    enqueueRequest(Request(new RequestObject(QVariant::fromValue(request), RequestType::Binding, RequestPriority::Configuration, [this, endpoint, clusterId, address, dstEndpointId, unbind, manual, callback] (bool success)
     {
-        logWarning << device << endpoint << name.toUtf8().constData() << "timed out";
-        return false;
-    }
+        if (success && manual)
+        {
+            Binding binding(new BindingObject(clusterId, address, dstEndpointId));
+            bool check = true;
 
-    m_requestId++;
+            for (int i = 0; i < endpoint->bindings().count(); i++)
+            {
+                const Binding &item = endpoint->bindings().at(i);
 
-    if (removeAll)
-    {
-        logInfo << device << endpoint << name.toUtf8().constData() << "finished successfully";
-        endpoint->groups().clear();
-        m_devices->storeDatabase();
-    }
-    else
-    {
-        bool check = true;
+                if (!item->name().isEmpty() || item->clusterId() != binding->clusterId() || item->address() != binding->address() || item->endpointId() != binding->endpointId())
+                    continue;
 
-        if (!m_groupsUpdated)
-            return true;
+                if (unbind)
+                {
+                    endpoint->bindings().removeAt(i);
+                    m_devices->storeDatabase();
+                }
 
-        for (int i = 0; i < endpoint->groups().count(); i++)
-        {
-            if (endpoint->groups().at(i) != groupId)
-                continue;
+                check = false;
+                break;
+            }
 
-            if (remove)
+            if (check && !unbind)
             {
-                endpoint->groups().removeAt(i);
+                endpoint->bindings().append(binding);
                 m_devices->storeDatabase();
             }
-
-            check = false;
-            break;
         }
 
-        if (check)
-        {
-            endpoint->groups().append(groupId);
-            m_devices->storeDatabase();
-        }
-    }
+        if (!callback)
+            return;
 
-    return true;
+        callback(success);
+    })));
 }
 
-bool ZigBee::dataRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &data, const QString &name)
+void ZigBee::groupRequest(const Endpoint &endpoint, quint16 groupId, bool removeAll, bool remove, const RequestCallback &callback)
 {
-    const Device &device = endpoint->device();
-
-    m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
-    m_replyId = m_requestId;
-    m_replyReceived = false;
+    QByteArray payload;
+    QString name;
+    DataRequest request;
 
-    if (!m_adapter->unicastRequest(m_requestId, device->networkAddress(), 0x01, endpoint->id(), clusterId, data))
+    if (removeAll)
     {
-        logWarning << device << endpoint << name.toUtf8().constData() << "aborted";
-        return false;
+        payload = zclHeader(FC_CLUSTER_SPECIFIC, endpoint->device()->nextTransactionId(), 0x04);
+        name = "remove all groups request";
     }
-
-    if (!m_replyReceived && !m_adapter->waitForSignal(this, SIGNAL(replyReceived()), NETWORK_REQUEST_TIMEOUT))
+    else
     {
-        logWarning << device << endpoint << name.toUtf8().constData() << "timed out";
-        return false;
+        quint16 value = qToLittleEndian(groupId);
+        payload = zclHeader(FC_CLUSTER_SPECIFIC, endpoint->device()->nextTransactionId(), remove ? 0x03 : 0x00).append(reinterpret_cast <char*> (&value), sizeof(value)).append(remove ? 0 : 1, 0x00);
+        name = QString("%1 group %2 request").arg(remove ? "remove" : "add").arg(groupId);
     }
 
-    m_requestId++;
+    request = DataRequest(new DataRequestObject(endpoint->device(), endpoint->id(), CLUSTER_GROUPS, payload, name, false, 0, Action()));
 
-    if (m_requestStatus)
+    enqueueRequest(Request(new RequestObject(QVariant::fromValue(request), RequestType::Data, RequestPriority::Configuration, [this, endpoint, removeAll, callback] (bool success)
     {
-        logWarning << device << endpoint << name.toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", m_requestStatus);
-        return false;
-    }
+        if (success && removeAll)
+        {
+            endpoint->groups().clear();
+            m_devices->storeDatabase();
+        }
 
-    logWarning << device << endpoint << name.toUtf8().constData() << "finished successfully";
-    return true;
+        if (!callback)
+            return;
+
+        callback(success);
+    }, !removeAll)));
+}
+
+void ZigBee::dataRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &data, const QString &name, const RequestCallback &callback)
+{
+    DataRequest request(new DataRequestObject(endpoint->device(), endpoint->id(), clusterId, data, name, false, 0, Action()));
+    enqueueRequest(Request(new RequestObject(QVariant::fromValue(request), RequestType::Data, RequestPriority::Configuration, callback)));
 }
 
 bool ZigBee::parseProperty(const Endpoint &endpoint, quint16 clusterId, quint8 transactionId, quint16 itemId, const QByteArray &data, bool command)
 {
     const Device &device = endpoint->device();
+    auto it = endpoint->clusterProperties().find(clusterId);
     bool check = false;
 
-    for (int i = 0; i < endpoint->properties().count(); i++)
-    {
-        const Property &property = endpoint->properties().at(i);
+    if (it == endpoint->clusterProperties().end())
+        return false;
 
-        if (property->clusters().contains(clusterId))
-        {
-            QVariant value = property->value();
+    for (int i = 0; i < it.value().count(); i++)
+    {
+        const Property &property = it.value().at(i);
+        QVariant value = property->value();
 
-            if (device->options().value("checkTransactionId").toBool() && property->transactionId() == transactionId)
-                continue;
+        if (device->settings().checkTransactionId && property->transactionId() == transactionId)
+            continue;
 
-            if (command)
-                property->parseCommand(clusterId, static_cast <quint8> (itemId), data);
-            else
-                property->parseAttribte(clusterId, itemId, data);
+        if (command)
+            property->parseCommand(clusterId, static_cast <quint8> (itemId), data);
+        else
+            property->parseAttribte(clusterId, itemId, data);
 
-            property->setTransactionId(transactionId);
-            check = true;
+        property->setTransactionId(transactionId);
+        check = true;
 
-            while (!property->queue().isEmpty())
-            {
-                const PropertyRequest &request = property->queue().dequeue();
-                enqueueRequest(device, endpoint->id(), request.clusterId, request.data);
-            }
+        while (!property->queue().isEmpty())
+        {
+            const PropertyRequest &request = property->queue().dequeue();
+            enqueueRequest(device, endpoint->id(), request.clusterId, request.data, RequestPriority::Response);
+        }
 
-            if (property->timeout())
-                property->setTime(QDateTime::currentSecsSinceEpoch());
+        if (property->timeout())
+            property->setTime(QDateTime::currentSecsSinceEpoch());
 
-            if (m_debounce && property->value() == value)
-                continue;
+        if (m_debounce && property->value() == value)
+            continue;
 
-            m_devices->storeProperties();
-            endpoint->setUpdated(true);
-        }
+        m_devices->storeProperties();
+        endpoint->setUpdated(true);
     }
 
     return check;
@@ -1024,7 +1675,7 @@ void ZigBee::parseAttribute(const Endpoint &endpoint, quint16 clusterId, quint8
             QDateTime now = QDateTime::currentDateTime();
             quint32 value = qToLittleEndian <quint32> (now.toTime_t() + now.offsetFromUtc() - TIME_OFFSET);
             logDebug(m_debug) << device << "requested EFEKTA time synchronization";
-            enqueueRequest(device, endpoint->id(), CLUSTER_TIME, writeAttributeRequest(m_requestId, 0x0000, 0x0000, DATA_TYPE_UTC_TIME, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))));
+            enqueueRequest(device, endpoint->id(), CLUSTER_TIME, writeAttributeRequest(device->nextTransactionId(), 0x0000, 0x0000, DATA_TYPE_UTC_TIME, QByteArray(reinterpret_cast <char*> (&value), sizeof(value))), RequestPriority::Response);
             return;
         }
 
@@ -1129,7 +1780,7 @@ void ZigBee::parseAttribute(const Endpoint &endpoint, quint16 clusterId, quint8
                     {
                         quint64 ieeeAddress;
 
-                        memcpy(&ieeeAddress, m_adapter->ieeeAddress().constData(), sizeof(ieeeAddress));
+                        memcpy(&ieeeAddress, m_ieeeAddress.constData(), sizeof(ieeeAddress));
                         ieeeAddress = qToLittleEndian(qFromBigEndian(ieeeAddress));
 
                         if (memcmp(&ieeeAddress, data.constData(), sizeof(ieeeAddress)))
@@ -1164,6 +1815,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 case 0x03:
                 {
                         const groupControlResponseStruct *response = reinterpret_cast <const groupControlResponseStruct*> (payload.constData());
+                        const Request &request = findRequest(device, transactionId);
                         quint16 groupId = qFromLittleEndian(response->groupId);
 
                         switch (response->status)
@@ -1178,9 +1830,22 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                                 break;
                         }
 
-                        m_groupRequestFinished = true;
-                        m_groupsUpdated = response->status == STATUS_SUCCESS ? true : false;
-                        emit groupRequestFinished();
+                        if (response->status == STATUS_SUCCESS)
+                        {
+                            if (commandId)
+                                endpoint->groups().removeAll(groupId);
+                            else if (!endpoint->groups().contains(groupId))
+                                endpoint->groups().append(groupId);
+
+                            m_devices->storeDatabase();
+                        }
+
+                        if (!request.isNull() && request->response() && (request->status() == RequestStatus::Pending || request->status() == RequestStatus::Sent))
+                        {
+                            request->setStatus(RequestStatus::Finished);
+                            requestCallback(request, true);
+                        }
+
                         break;
                 }
 
@@ -1237,7 +1902,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
 
                     logInfo << device << "OTA upgrade started...";
 
-                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x02).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x02).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::OTA);
                     emit deviceEvent(device.data(), Event::otaUpgradeStarted);
                     break;
                 }
@@ -1281,7 +1946,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     device->ota().setProgress(static_cast <double> (qFromLittleEndian(request->fileOffset) + buffer.length()) / device->ota().imageSize() * 100);
                     logInfo << device << "OTA upgrade progress is" << QString::asprintf("%.2f%%", device->ota().progress()).toUtf8().constData();
 
-                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x05).append(reinterpret_cast <char*> (&response), sizeof(response)).append(buffer));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x05).append(reinterpret_cast <char*> (&response), sizeof(response)).append(buffer), RequestPriority::OTA);
                     break;
                 }
 
@@ -1311,7 +1976,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     device->setInterviewStatus(InterviewStatus::BasicAttributes);
                     logInfo << device << "OTA upgrade finished successfully";
 
-                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x07).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x07).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::OTA);
                     emit deviceEvent(device.data(), Event::otaUpgradeFinished);
                     break;
                 }
@@ -1324,6 +1989,21 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
             return;
         }
 
+        case CLUSTER_POLL_CONTROL:
+        {
+            if (commandId == 0x00)
+            {
+                pollControlCheckInResponseStruct response;
+                logDebug(m_debug) << device << "poll control check-in received";
+                response.startFastPolling = device->mailbox().isEmpty() ? 0x00 : 0x01;
+                response.fastPollTimeout = qToLittleEndian <quint16> (FAST_POLL_TIMEOUT);
+                enqueueRequest(device, endpoint->id(), CLUSTER_POLL_CONTROL, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x00).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Response);
+                return;
+            }
+
+            break;
+        }
+
         case CLUSTER_IAS_ZONE:
         {
             if (commandId == 0x01)
@@ -1332,7 +2012,7 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 logDebug(m_debug) << device << "requested IAS Zone enroll";
                 response.responseCode = 0x00;
                 response.zoneId = IAS_ZONE_ID;
-                enqueueRequest(device, endpoint->id(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x00).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                enqueueRequest(device, endpoint->id(), CLUSTER_IAS_ZONE, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x00).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Response);
                 return;
             }
 
@@ -1352,13 +2032,13 @@ void ZigBee::clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     response.payloadSize = qToLittleEndian <quint16> (8);
                     response.utcTimestamp = qToBigEndian(value);
                     response.localTimestamp = qToBigEndian(value + now.offsetFromUtc());
-                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x24).append(reinterpret_cast <char*> (&response), sizeof(response)));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x24).append(reinterpret_cast <char*> (&response), sizeof(response)), RequestPriority::Response);
                     return;
                 }
 
                 case 0x25:
                 {
-                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x25).append(QByteArray::fromHex("010001")));
+                    enqueueRequest(device, endpoint->id(), CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, transactionId, 0x25).append(QByteArray::fromHex("010001")), RequestPriority::Response);
                     return;
                 }
             }
@@ -1416,7 +2096,7 @@ void ZigBee::globalCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                     {
                         case 0x0000:
                             logDebug(m_debug) << device << "requested UTC time";
-                            value = qToLittleEndian <quint32> (now.toTime_t() + (device->options().value("utcTime").toBool() ? now.offsetFromUtc() : 0) - TIME_OFFSET);
+                            value = qToLittleEndian <quint32> (now.toTime_t() + (device->settings().utcTime ? now.offsetFromUtc() : 0) - TIME_OFFSET);
                             response.append(1, static_cast <char> (DATA_TYPE_UTC_TIME)).append(reinterpret_cast <char*> (&value), sizeof(value));
                             break;
 
@@ -1440,7 +2120,7 @@ void ZigBee::globalCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 response.append(1, static_cast <char> (STATUS_UNSUPPORTED_ATTRIBUTE));
             }
 
-            enqueueRequest(device, endpoint->id(), clusterId, response);
+            enqueueRequest(device, endpoint->id(), clusterId, response, RequestPriority::Response);
             break;
         }
 
@@ -1486,7 +2166,17 @@ void ZigBee::globalCommandReceived(const Endpoint &endpoint, quint16 clusterId,
                 payload.remove(0, offset + size);
             }
 
-            if (clusterId == CLUSTER_BASIC && device->interviewStatus() != InterviewStatus::Finished && static_cast <int> (device->interviewStatus()) >= static_cast <int> (InterviewStatus::BasicAttributes))
+            if (clusterId == CLUSTER_BASIC && device->interviewStatus() == InterviewStatus::Fingerprint)
+            {
+                if (!restoreFingerprint(device))
+                    device->endpoints().clear();
+
+                device->setInterviewStatus(device->endpoints().isEmpty() ? InterviewStatus::ActiveEndpoints : InterviewStatus::ColorCapabilities);
+                interviewDevice(device);
+                break;
+            }
+
+            if (clusterId == CLUSTER_BASIC && static_cast <int> (device->interviewStatus()) >= static_cast <int> (InterviewStatus::BasicAttributes) && static_cast <int> (device->interviewStatus()) < static_cast <int> (InterviewStatus::Finished))
             {
                 device->setInterviewStatus(device->interviewStatus() == InterviewStatus::BasicAttributes ? InterviewStatus::ColorCapabilities : static_cast <InterviewStatus> (static_cast <int> (device->interviewStatus()) + 1));
                 interviewDevice(device);
@@ -1512,7 +2202,7 @@ void ZigBee::globalCommandReceived(const Endpoint &endpoint, quint16 clusterId,
     }
 }
 
-void ZigBee::touchLinkReset(const QByteArray &ieeeAddress, quint8 channel)
+void ZigBee::touchLinkReset(quint8 tag, const QByteArray &ieeeAddress, quint8 channel)
 {
     touchLinkScanStruct payload;
 
@@ -1520,16 +2210,16 @@ void ZigBee::touchLinkReset(const QByteArray &ieeeAddress, quint8 channel)
     payload.zigBeeInformation = 0x04;
     payload.touchLinkInformation = 0x12;
 
-    if (!m_adapter->setInterPanChannel(channel))
+    if (!adapterCall([&] () { return m_adapter->setInterPanChannel(channel); }))
         return;
 
-    if (!m_adapter->broadcastInterPanRequest(m_requestId, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0x00).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload)))))
+    if (!adapterCall([&] () { return m_adapter->broadcastInterPanRequest(tag, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, tag, 0x00).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload)))); }))
     {
         logWarning << "TouchLink scan request failed";
         return;
     }
 
-    if (!m_adapter->unicastInterPanRequest(m_requestId, ieeeAddress, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0x07).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload.transactionId)))))
+    if (!adapterCall([&] () { return m_adapter->unicastInterPanRequest(tag, ieeeAddress, CLUSTER_TOUCHLINK, zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, tag, 0x07).append(QByteArray(reinterpret_cast <char*> (&payload), sizeof(payload.transactionId)))); }))
     {
         logWarning << "TouchLink reset request failed";
         return;
@@ -1538,9 +2228,9 @@ void ZigBee::touchLinkReset(const QByteArray &ieeeAddress, quint8 channel)
     logInfo << "TouchLink reset finished successfully";
 }
 
-void ZigBee::touchLinkScan(void)
+void ZigBee::touchLinkScan(quint8 tag)
 {
-    QByteArray request = zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, m_requestId, 0x00);
+    QByteArray request = zclHeader(FC_CLUSTER_SPECIFIC | FC_DISABLE_DEFAULT_RESPONSE, tag, 0x00);
     touchLinkScanStruct payload;
     QEventLoop loop;
     QTimer timer;
@@ -1556,10 +2246,10 @@ void ZigBee::touchLinkScan(void)
 
     for (m_interPanChannel = 11; m_interPanChannel <= 26; m_interPanChannel++)
     {
-        if (!m_adapter->setInterPanChannel(m_interPanChannel))
+        if (!adapterCall([&] () { return m_adapter->setInterPanChannel(m_interPanChannel); }))
             return;
 
-        if (!m_adapter->broadcastInterPanRequest(m_requestId, CLUSTER_TOUCHLINK, request))
+        if (!adapterCall([&] () { return m_adapter->broadcastInterPanRequest(tag, CLUSTER_TOUCHLINK, request); }))
         {
             logWarning << "TouchLink scan request failed";
             return;
@@ -1583,6 +2273,14 @@ void ZigBee::interviewTimeoutHandler(const Device &device)
         return;
     }
 
+    if (device->interviewStatus() == InterviewStatus::Fingerprint)
+    {
+        device->endpoints().clear();
+        device->setInterviewStatus(InterviewStatus::ActiveEndpoints);
+        interviewDevice(device);
+        return;
+    }
+
     if (device->interviewStatus() == InterviewStatus::BasicAttributes)
     {
         device->setInterviewStatus(InterviewStatus::ApplicationVersion);
@@ -1604,23 +2302,57 @@ void ZigBee::rejoinHandler(const Device &device)
             for (int i = 0; i < it.value()->reportings().count(); i++)
                 configureReporting(it.value(), it.value()->reportings().at(i));
 
-    if (device->options().value("tuyaDataQuery").toBool())
-        enqueueRequest(device, 0x01, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, m_requestId, 0x03), "data query request");
+    if (device->settings().tuyaDataQuery)
+        enqueueRequest(device, 0x01, CLUSTER_TUYA_DATA, zclHeader(FC_CLUSTER_SPECIFIC, device->nextTransactionId(), 0x03), RequestPriority::Poll, "data query request");
+}
+
+void ZigBee::deviceAwake(const Device &device)
+{
+    device->setAwakeTime(QDateTime::currentMSecsSinceEpoch());
+
+    if (device->mailbox().isEmpty())
+        return;
+
+    logDebug(m_debug) << device << "awake," << device->mailbox().count() << "held requests released";
+
+    for (int i = 0; i < device->mailbox().count(); i++)
+    {
+        const Request &request = m_requests.value(device->mailbox().at(i));
+
+        if (request.isNull() || request->status() != RequestStatus::Pending)
+            continue;
+
+        m_queues[request->priority()].enqueue(device->ieeeAddress(), device->mailbox().at(i));
+    }
+
+    device->mailbox().clear();
+
+    if (!m_requestTimer->isActive() && !m_interPanLock)
+        m_requestTimer->start();
 }
 
 void ZigBee::restoreGroups(const Device &device)
 {
+    QList <RequestStep> steps;
+
     for (auto it = device->endpoints().begin(); it != device->endpoints().end(); it++)
     {
-        for (int i = 0; i < it.value()->groups().count(); i++)
-        {
-            if (groupRequest(it.value(), it.value()->groups().at(i)))
-                continue;
+        const Endpoint &endpoint = it.value();
 
-            logWarning << device << "groups restore failed";
-            return;
+        for (int i = 0; i < endpoint->groups().count(); i++)
+        {
+            quint16 groupId = endpoint->groups().at(i);
+            steps.append([this, endpoint, groupId] (const RequestCallback &callback) { groupRequest(endpoint, groupId, false, false, callback); });
         }
     }
+
+    runSteps(steps, [device] (bool success)
+    {
+        if (success)
+            return;
+
+        logWarning << device << "groups restore failed";
+    });
 }
 
 void ZigBee::storeNeighbors(void)
@@ -1645,7 +2377,7 @@ void ZigBee::otaError(const Endpoint &endpoint, quint16 manufacturerCode, quint8
     }
 
     if (response)
-        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, commandId == 0x01 ? 0x02 : 0x05, manufacturerCode).append(STATUS_NO_IMAGE_AVAILABLE));
+        enqueueRequest(device, endpoint->id(), CLUSTER_OTA_UPGRADE, zclHeader(FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, commandId == 0x01 ? 0x02 : 0x05, manufacturerCode).append(STATUS_NO_IMAGE_AVAILABLE), RequestPriority::OTA);
 
     device->ota().reset();
 
@@ -1669,13 +2401,15 @@ void ZigBee::adapterReset(void)
     m_requestTimer->stop();
 }
 
-void ZigBee::coordinatorReady(void)
+void ZigBee::coordinatorReady(const QByteArray &ieeeAddress, const QString &manufacturerName, const QString &modelName, const QString &firmware)
 {
-    Device device = m_devices->value(m_adapter->ieeeAddress());
+    Device device = m_devices->value(ieeeAddress);
+
+    m_ieeeAddress = ieeeAddress;
 
     if (device.isNull())
     {
-        device = Device(new DeviceObject(m_adapter->ieeeAddress(), 0x0000, "HOMEd Coordinator"));
+        device = Device(new DeviceObject(ieeeAddress, 0x0000, "HOMEd Coordinator"));
         m_devices->insert(device->ieeeAddress(), device);
     }
 
@@ -1687,6 +2421,7 @@ void ZigBee::coordinatorReady(void)
         if (it.value()->logicalType() == LogicalType::Coordinator && it.key() != device->ieeeAddress())
         {
             logWarning << "Coordinator" << it.value()->ieeeAddress().toHex(':') << "removed";
+            m_devices->unindexDevice(it.value());
             m_devices->erase(it++);
         }
 
@@ -1694,12 +2429,14 @@ void ZigBee::coordinatorReady(void)
             break;
     }
 
+    m_devices->indexDevice(device);
+
     device->setRemoved(false);
     device->setInterviewStatus(InterviewStatus::Finished);
     device->setLogicalType(LogicalType::Coordinator);
-    device->setFirmware(m_adapter->firmware());
-    device->setManufacturerName(m_adapter->manufacturerName());
-    device->setModelName(m_adapter->modelName());
+    device->setFirmware(firmware);
+    device->setManufacturerName(manufacturerName);
+    device->setModelName(modelName);
     device->setActive(true);
     device->setDiscovery(false);
     device->setCloud(false);
@@ -1715,7 +2452,7 @@ void ZigBee::coordinatorReady(void)
     connect(m_pingTimer, &QTimer::timeout, this, &ZigBee::pingDevices, Qt::UniqueConnection);
 
     logInfo << "Coordinator ready, address:" << device->ieeeAddress().toHex(':');
-    m_adapter->setPermitJoin(m_devices->permitJoin());
+    setPermitJoin(m_devices->permitJoin());
 
     if (!m_requests.isEmpty())
         m_requestTimer->start();
@@ -1776,14 +2513,18 @@ void ZigBee::deviceJoined(const QByteArray &ieeeAddress, quint16 networkAddress)
 
     it.value()->updateJoinTime();
     it.value()->updateLastSeen();
+    deviceAwake(it.value());
     blink(500);
 
     if (it.value()->networkAddress() != networkAddress)
     {
         logInfo << it.value() << "network address updated";
+        m_devices->unindexDevice(it.value());
         it.value()->setNetworkAddress(networkAddress);
     }
 
+    m_devices->indexDevice(it.value());
+
     if (it.value()->interviewStatus() != InterviewStatus::Finished && !it.value()->timer()->isActive())
     {
         logInfo << it.value() << "interview started...";
@@ -1806,6 +2547,7 @@ void ZigBee::deviceLeft(const QByteArray &ieeeAddress)
     logInfo << it.value() << "left network";
     emit deviceEvent(it.value().data(), Event::deviceLeft);
 
+    abortRequests(it.value());
     m_devices->removeDevice(it.value());
     m_devices->storeDatabase();
 }
@@ -1839,6 +2581,26 @@ void ZigBee::zdoMessageReveived(quint16 networkAddress, quint16 clusterId, const
 
                 logInfo << device << "node descriptor received, manufacturer code is" << QString::asprintf("0x%04x", device->manufacturerCode()) << "and logical type is" << QString(device->logicalType() == LogicalType::Router ? "router" : "end device");
                 device->setInterviewStatus(InterviewStatus::ActiveEndpoints);
+
+                if (device->endpoints().isEmpty())
+                {
+                    QString key = fingerprint(device, true);
+                    auto it = m_fingerprints.lowerBound(key);
+
+                    if (it != m_fingerprints.end() && it.key().startsWith(key))
+                    {
+                        for (auto item = it.value()->endpoints().begin(); item != it.value()->endpoints().end(); item++)
+                        {
+                            if (!item.value()->inClusters().contains(CLUSTER_BASIC))
+                                continue;
+
+                            m_devices->endpoint(device, item.key())->inClusters().append(CLUSTER_BASIC);
+                            device->setInterviewStatus(InterviewStatus::Fingerprint);
+                            break;
+                        }
+                    }
+                }
+
                 interviewDevice(device);
                 break;
             }
@@ -1850,40 +2612,52 @@ void ZigBee::zdoMessageReveived(quint16 networkAddress, quint16 clusterId, const
         case ZDO_SIMPLE_DESCRIPTOR_REQUEST:
         {
             const simpleDescriptorResponseStruct *response = reinterpret_cast <const simpleDescriptorResponseStruct*> (payload.constData());
-            Endpoint endpoint = m_devices->endpoint(device, response->status ? device->interviewEndpointId() : response->endpointId);
+            QByteArray clusterData = payload.mid(sizeof(simpleDescriptorResponseStruct));
+            Endpoint endpoint;
+            quint16 clusterId;
 
-            if (device->interviewStatus() != InterviewStatus::SimpleDescriptors)
+            if (device->interviewStatus() != InterviewStatus::SimpleDescriptors || response->status)
                 break;
 
-            if (!response->status)
+            endpoint = m_devices->endpoint(device, response->endpointId);
+
+            for (auto it = m_descriptorTags.begin(); it != m_descriptorTags.end(); )
             {
-                QByteArray clusterData = payload.mid(sizeof(simpleDescriptorResponseStruct));
-                quint16 clusterId;
+                if (it.value().first != device->ieeeAddress() || it.value().second != endpoint->id())
+                {
+                    it++;
+                    continue;
+                }
 
-                endpoint->setProfileId(qFromLittleEndian(response->profileId));
-                endpoint->setDeviceId(qFromLittleEndian(response->deviceId));
+                it = m_descriptorTags.erase(it);
+            }
 
-                endpoint->inClusters().clear();
-                endpoint->outClusters().clear();
+            endpoint->setProfileId(qFromLittleEndian(response->profileId));
+            endpoint->setDeviceId(qFromLittleEndian(response->deviceId));
 
-                for (quint8 i = 0; i < static_cast <quint8> (clusterData.at(0)); i++)
-                {
-                    memcpy(&clusterId, clusterData.constData() + i * sizeof(clusterId) + 1, sizeof(clusterId));
-                    endpoint->inClusters().append(qFromLittleEndian(clusterId));
-                }
+            endpoint->inClusters().clear();
+            endpoint->outClusters().clear();
+
+            for (quint8 i = 0; i < static_cast <quint8> (clusterData.at(0)); i++)
+            {
+                memcpy(&clusterId, clusterData.constData() + i * sizeof(clusterId) + 1, sizeof(clusterId));
+                endpoint->inClusters().append(qFromLittleEndian(clusterId));
+            }
 
-                clusterData.remove(0, clusterData.at(0) * sizeof(clusterId) + 1);
+            clusterData.remove(0, clusterData.at(0) * sizeof(clusterId) + 1);
 
-                for (quint8 i = 0; i < static_cast <quint8> (clusterData.at(0)); i++)
-                {
-                    memcpy(&clusterId, clusterData.constData() + i * sizeof(clusterId) + 1, sizeof(clusterId));
-                    endpoint->outClusters().append(qFromLittleEndian(clusterId));
-                }
+            for (quint8 i = 0; i < static_cast <quint8> (clusterData.at(0)); i++)
+            {
+                memcpy(&clusterId, clusterData.constData() + i * sizeof(clusterId) + 1, sizeof(clusterId));
+                endpoint->outClusters().append(qFromLittleEndian(clusterId));
             }
 
-            logInfo << device << endpoint << "simple descriptor" << (response->status ? "unavailable" : "received");
+            logInfo << device << endpoint << "simple descriptor received";
             endpoint->setDescriptorStatus(DescriptorStatus::Received);
-            interviewDevice(device);
+
+            if (!pendingDescriptors(device))
+                interviewDevice(device);
+
             break;
         }
 
@@ -1937,7 +2711,7 @@ void ZigBee::zdoMessageReveived(quint16 networkAddress, quint16 clusterId, const
                 if (response->total > response->index + response->count)
                 {
                     device->setLqiRequestIndex(response->index + response->count);
-                    enqueueRequest(device, RequestType::LQI);
+                    enqueueRequest(device, RequestType::LQI, RequestPriority::Neighbors);
                     break;
                 }
             }
@@ -1954,6 +2728,7 @@ void ZigBee::zdoMessageReveived(quint16 networkAddress, quint16 clusterId, const
         }
     }
 
+    deviceAwake(device);
     device->updateLastSeen();
 }
 
@@ -1988,7 +2763,7 @@ void ZigBee::zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint
         data = payload.mid(3);
     }
 
-    request = m_requests.value(transactionId);
+    request = findRequest(device, transactionId);
 
     if (!request.isNull() && request->type() == RequestType::Data && qvariant_cast <DataRequest> (request->data())->debug())
     {
@@ -2005,6 +2780,9 @@ void ZigBee::zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint
     else
         globalCommandReceived(endpoint, clusterId, manufacturerCode, transactionId, commandId, data);
 
+    if (!request.isNull())
+        releaseTransaction(request);
+
     if (device->interviewStatus() == InterviewStatus::Finished && (frameControl & FC_CLUSTER_SPECIFIC || commandId == CMD_REPORT_ATTRIBUTES) && !(frameControl & FC_DISABLE_DEFAULT_RESPONSE))
     {
         defaultResponseStruct response;
@@ -2012,12 +2790,13 @@ void ZigBee::zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint
         response.commandId = commandId;
         response.status = 0x00;
 
-        enqueueRequest(device, endpoint->id(), clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_DEFAULT_RESPONSE, manufacturerCode).append(QByteArray(reinterpret_cast <char*> (&response), sizeof(response))));
+        enqueueRequest(device, endpoint->id(), clusterId, zclHeader(FC_SERVER_TO_CLIENT | FC_DISABLE_DEFAULT_RESPONSE, transactionId, CMD_DEFAULT_RESPONSE, manufacturerCode).append(QByteArray(reinterpret_cast <char*> (&response), sizeof(response))), RequestPriority::Response);
     }
 
     if (endpoint->updated() || (endpoint->properties().isEmpty() && endpoint->inClusters().contains(CLUSTER_BASIC)))
         emit endpointUpdated(device.data(), endpoint->id());
 
+    deviceAwake(device);
     device->updateLastSeen();
 }
 
@@ -2034,18 +2813,18 @@ void ZigBee::rawMessageReveived(const QByteArray &ieeeAddress, quint16 clusterId
 
 void ZigBee::requestFinished(quint8 id, quint8 status)
 {
-    auto it = m_requests.find(id);
+    auto tag = m_tags.find(id);
+    auto it = tag != m_tags.end() ? m_requests.find(tag.value()) : m_requests.end();
 
-    if (id == m_replyId)
-    {
-        m_requestStatus = status;
-        m_replyReceived = true;
-        emit replyReceived();
-    }
+    if (status)
+        descriptorFailed(id, status);
 
-    if (it == m_requests.end() || it.value()->status() == RequestStatus::Finished)
+    if (it == m_requests.end() || it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted || (it.value()->response() && !status))
         return;
 
+    if (!status)
+        requestDevice(it.value())->setRequestFailures(0);
+
     switch (it.value()->type())
     {
         case RequestType::Data:
@@ -2074,9 +2853,24 @@ void ZigBee::requestFinished(quint8 id, quint8 status)
                 emit endpointUpdated(device.data(), request->endpointId());
             }
 
-            if (!request->action()->attributes().isEmpty() && !device->options().value("skipAttributeRead").toBool())
-                enqueueRequest(device, request->endpointId(), request->clusterId(), readAttributesRequest(m_requestId, request->manufacturerCode(), request->action()->attributes()));
+            if (!request->action()->attributes().isEmpty() && !device->settings().skipAttributeRead)
+                readAttributes(device, request->endpointId(), request->clusterId(), request->manufacturerCode(), request->action()->attributes(), RequestPriority::Action);
+
+            break;
+        }
+
+        case RequestType::Binding:
+        {
+            const BindingRequest &request = qvariant_cast <BindingRequest> (it.value()->data());
+            const Device &device = request->endpoint()->device();
+
+            if (status)
+            {
+                logWarning << device << request->endpoint() << "cluster" << QString::asprintf("0x%04x", request->clusterId()) << request->name().toUtf8().constData() << "failed, status code:" << QString::asprintf("0x%02x", status);
+                break;
+            }
 
+            logInfo << device << request->endpoint() << "cluster" << QString::asprintf("0x%04x", request->clusterId()) << request->name().toUtf8().constData() << "finished successfully";
             break;
         }
 
@@ -2093,6 +2887,7 @@ void ZigBee::requestFinished(quint8 id, quint8 status)
             logInfo << device << "removed";
             emit deviceEvent(device.data(), Event::deviceRemoved);
 
+            abortRequests(device);
             m_devices->removeDevice(device);
             m_devices->storeDatabase();
             break;
@@ -2109,94 +2904,236 @@ void ZigBee::requestFinished(quint8 id, quint8 status)
             break;
         }
 
-        default:
+        case RequestType::Interview:
+        {
+            const Device &device = qvariant_cast <Device> (it.value()->data());
+
+            if (!status || device->interviewStatus() == InterviewStatus::SimpleDescriptors)
+                break;
+
+            if (device->interviewStatus() == InterviewStatus::Fingerprint)
+            {
+                device->endpoints().clear();
+                device->setInterviewStatus(InterviewStatus::ActiveEndpoints);
+                interviewDevice(device);
+                break;
+            }
+
+            interviewError(device, QString::asprintf("request failed, status code: 0x%02x", status));
             break;
+        }
     }
 
     it.value()->setStatus(RequestStatus::Finished);
+    requestCallback(it.value(), !status);
 }
 
 void ZigBee::handleRequests(void)
 {
-    for (auto it = m_requests.begin(); it != m_requests.end(); it++)
+    qint64 time = QDateTime::currentMSecsSinceEpoch();
+    bool throttled = false;
+    int count = 0;
+
+    RequestFilter filter = [this, time, &throttled] (quint32 id)
+    {
+        const Request &request = m_requests.value(id);
+        Device device;
+
+        if (request.isNull())
+            return true;
+
+        device = requestDevice(request);
+
+        if (requestToken(device, time))
+            return true;
+
+        if (!request->throttled())
+        {
+            logDebug(m_debug) << device << "request" << id << "throttled";
+            request->setThrottled(true);
+            device->increaseThrottled();
+        }
+
+        throttled = true;
+        return false;
+    };
+
+    for (auto it = m_requests.begin(); it != m_requests.end(); )
     {
-        if (it.value()->status() != RequestStatus::Pending)
+        if (it.value()->status() != RequestStatus::Finished && it.value()->status() != RequestStatus::Aborted)
+        {
+            it++;
             continue;
+        }
+
+        auto tag = m_tags.find(it.value()->tag());
 
-        switch (it.value()->type())
+        if (tag != m_tags.end() && tag.value() == it.key())
         {
-            case RequestType::Data:
-            {
-                const DataRequest &request = qvariant_cast <DataRequest> (it.value()->data());
-                const Device &device = request->device();
+            m_queues[it.value()->priority()].release();
+            m_tags.erase(tag);
+        }
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+        if (it.value()->status() == RequestStatus::Finished && it.value()->deadline() > time && pendingTransaction(it.value()))
+        {
+            it++;
+            continue;
+        }
 
-                if (!m_adapter->unicastRequest(it.key(), device->networkAddress(), 0x01, request->endpointId(), request->clusterId(), request->data()))
-                {
-                    logWarning << device << (!request->name().isEmpty() ? request->name().toUtf8().constData() : "data request") << "aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
-                    it.value()->setStatus(RequestStatus::Aborted);
-                }
+        releaseTransaction(it.value());
+        it = m_requests.erase(it);
+    }
 
+    for (auto it = m_queues.begin(); it != m_queues.end() && count < REQUEST_DISPATCH_BATCH && tagAvailable(); it++)
+    {
+        while (it.value().ready() && count < REQUEST_DISPATCH_BATCH && tagAvailable())
+        {
+            Request request;
+            quint32 id;
+            quint8 tag;
+
+            if (!it.value().dequeue(id, it.key() != RequestPriority::Action ? filter : RequestFilter()))
                 break;
+
+            request = m_requests.value(id);
+
+            if (request.isNull() || request->status() != RequestStatus::Pending)
+            {
+                it.value().release();
+                continue;
             }
 
-            case RequestType::Leave:
+            tag = adapterTag();
+            request->setTag(tag);
+            m_tags.insert(tag, id);
+            count++;
+
+            switch (request->type())
             {
-                const Device &device = qvariant_cast <Device> (it.value()->data());
+                case RequestType::Data:
+                {
+                    const DataRequest &data = qvariant_cast <DataRequest> (request->data());
+                    quint16 networkAddress = data->device()->networkAddress();
+                    quint8 endpointId = data->endpointId();
+                    quint16 clusterId = data->clusterId();
+                    QByteArray payload = data->data();
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+                    adapterRequest(tag, data->device(), [this, tag, networkAddress, endpointId, clusterId, payload] () { return m_adapter->unicastRequest(tag, networkAddress, 0x01, endpointId, clusterId, payload); });
+                    break;
+                }
 
-                if (!m_adapter->leaveRequest(it.key(), device->networkAddress()))
+                case RequestType::Binding:
                 {
-                    logWarning << device << "leave request aborted, status code:" << QString::asprintf("0x%02x", m_adapter->replyStatus());
-                    it.value()->setStatus(RequestStatus::Aborted);
+                    const BindingRequest &binding = qvariant_cast <BindingRequest> (request->data());
+                    quint16 networkAddress = binding->endpoint()->device()->networkAddress();
+                    quint8 endpointId = binding->endpoint()->id(), dstEndpointId = binding->dstEndpointId();
+                    quint16 clusterId = binding->clusterId();
+                    QByteArray address = binding->address();
+                    bool unbind = binding->unbind();
+
+                    adapterRequest(tag, binding->endpoint()->device(), [this, tag, networkAddress, endpointId, clusterId, address, dstEndpointId, unbind] () { return m_adapter->bindRequest(tag, networkAddress, endpointId, clusterId, address, dstEndpointId, unbind); });
+                    break;
                 }
 
-                break;
-            }
+                case RequestType::Leave:
+                {
+                    const Device &device = qvariant_cast <Device> (request->data());
+                    quint16 networkAddress = device->networkAddress();
 
-            case RequestType::LQI:
-            {
-                const Device &device = qvariant_cast <Device> (it.value()->data());
+                    adapterRequest(tag, device, [this, tag, networkAddress] () { return m_adapter->leaveRequest(tag, networkAddress); });
+                    break;
+                }
+
+                case RequestType::LQI:
+                {
+                    const Device &device = qvariant_cast <Device> (request->data());
+                    quint16 networkAddress = device->networkAddress();
+                    quint8 index = device->lqiRequestIndex();
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+                    adapterRequest(tag, device, [this, tag, networkAddress, index] () { return m_adapter->lqiRequest(tag, networkAddress, index); });
+                    break;
+                }
 
-                if (!m_adapter->lqiRequest(it.key(), device->networkAddress(), device->lqiRequestIndex()))
-                    it.value()->setStatus(RequestStatus::Aborted);
+                case RequestType::Interview:
 
-                break;
+                    if (!interviewRequest(tag, qvariant_cast <Device> (request->data())))
+                        request->setStatus(RequestStatus::Aborted);
+
+                    break;
             }
 
-            case RequestType::Interview:
-            {
-                const Device &device = qvariant_cast <Device> (it.value()->data());
+            if (request->status() == RequestStatus::Aborted)
+                requestCallback(request, false);
 
-                m_adapter->setRequestParameters(device->ieeeAddress(), device->batteryPowered());
+            if (request->status() == RequestStatus::Finished || request->status() == RequestStatus::Aborted)
+                continue;
 
-                if (!interviewRequest(it.key(), device))
-                    it.value()->setStatus(RequestStatus::Aborted);
+            request->setStatus(RequestStatus::Sent);
+            releasePending(request);
+            request->setDeadline(QDateTime::currentMSecsSinceEpoch() + NETWORK_REQUEST_TIMEOUT);
 
-                break;
-            }
+            if (!m_timeoutTimer->isActive())
+                m_timeoutTimer->start(REQUEST_SWEEP_INTERVAL);
         }
+    }
+
+    if (count && tagAvailable())
+        return;
+
+    m_requestTimer->stop();
+
+    if (!throttled)
+        return;
+
+    QTimer::singleShot(qMax(1000 / m_requestRate, 1), this, [this] ()
+    {
+        if (!m_requestTimer->isActive() && !m_interPanLock)
+            m_requestTimer->start();
+    });
+}
+
+void ZigBee::expireRequests(void)
+{
+    qint64 time = QDateTime::currentMSecsSinceEpoch();
+    QList <quint32> list;
+    bool sent = false;
+
+    for (auto it = m_requests.begin(); it != m_requests.end(); it++)
+    {
+        if (it.value()->status() != RequestStatus::Sent)
+            continue;
 
-        if (it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted)
+        if (it.value()->deadline() > time)
+        {
+            sent = true;
             continue;
+        }
 
-        it.value()->setStatus(RequestStatus::Sent);
+        list.append(it.key());
     }
 
-    for (auto it = m_requests.begin(); it != m_requests.end(); it++)
+    for (int i = 0; i < list.count(); i++)
     {
-        if (it.value()->status() == RequestStatus::Finished || it.value()->status() == RequestStatus::Aborted)
-            m_requests.erase(it++);
+        const Request &request = m_requests.value(list.at(i));
+        Device device;
 
-        if (it == m_requests.end())
-            break;
+        if (request.isNull() || request->status() != RequestStatus::Sent)
+            continue;
+
+        device = requestDevice(request);
+
+        if (request->retries() < m_requestRetries && idempotentRequest(request))
+            retryRequest(list.at(i), request);
+        else
+            requestTimeout(request);
+
+        device->setRequestFailures(device->requestFailures() + 1);
     }
 
-    m_requestTimer->stop();
+    if (sent)
+        return;
+
+    m_timeoutTimer->stop();
 }
 
 void ZigBee::updateNeighbors(void)
@@ -2208,7 +3145,7 @@ void ZigBee::updateNeighbors(void)
 
         it.value()->setLqiRequestIndex(0);
         it.value()->setLqiRequestPending(true);
-        enqueueRequest(it.value(), RequestType::LQI);
+        enqueueRequest(it.value(), RequestType::LQI, RequestPriority::Neighbors);
     }
 }
 
@@ -2227,7 +3164,7 @@ void ZigBee::pingDevices(void)
         {
             if (it.value()->inClusters().contains(CLUSTER_BASIC))
             {
-                enqueueRequest(device, it.key(), CLUSTER_BASIC, readAttributesRequest(m_requestId, 0x0000, {0x0000}));
+                readAttributes(device, it.key(), CLUSTER_BASIC, 0x0000, {0x0000}, RequestPriority::Poll);
                 break;
             }
         }
@@ -2246,7 +3183,7 @@ void ZigBee::interviewTimeout(void)
 
 void ZigBee::pollRequest(EndpointObject *endpoint, const Poll &poll)
 {
-    enqueueRequest(endpoint->device(), endpoint->id(), poll->clusterId(), readAttributesRequest(m_requestId, 0x0000, poll->attributes()));
+    readAttributes(endpoint->device(), endpoint->id(), poll->clusterId(), 0x0000, poll->attributes(), RequestPriority::Poll);
 }
 
 void ZigBee::updateStatusLed(void)
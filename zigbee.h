@@ -6,29 +6,70 @@
 #define NETWORK_REQUEST_TIMEOUT         8000
 #define DEVICE_REJOIN_TIMEOUT           5000
 #define INTER_PAN_CHANNEL_TIMEOUT       100
+#define ADAPTER_CALL_TIMEOUT            10000
 #define STATUS_LED_TIMEOUT              500
 
+#define REQUEST_DISPATCH_BATCH          8
+#define REQUEST_SWEEP_INTERVAL          1000
+#define REQUEST_MAX_BACKOFF             30000
+#define REQUEST_MAX_RATE                100
+#define READ_ATTRIBUTES_LIMIT           16
+
+#define CONFIGURATION_LIMIT             4
+#define CONFIGURATION_TIMEOUT           60000
+
+#define SLEEPY_AWAKE_TIMEOUT            3000
+#define SLEEPY_MAILBOX_SIZE             32
+#define FAST_POLL_TIMEOUT               40
+#define REQUEST_LIMIT_OTA               2
+#define REQUEST_LIMIT_INTERVIEW         8
+#define REQUEST_LIMIT_CONFIGURATION     4
+#define REQUEST_LIMIT_POLL              4
+#define REQUEST_LIMIT_NEIGHBORS         2
+
 #define TIME_OFFSET                     946684800
 #define OTA_MAX_LENGTH                  10485760
 #define IAS_ZONE_ID                     0x42
 
+#include <functional>
 #include <QMetaEnum>
+#include <QSet>
+#include <QThread>
 #include "device.h"
 
 class DataRequestObject;
 typedef QSharedPointer <DataRequestObject> DataRequest;
 
+class BindingRequestObject;
+typedef QSharedPointer <BindingRequestObject> BindingRequest;
+
 class RequestObject;
 typedef QSharedPointer <RequestObject> Request;
 
+typedef std::function <void (bool success)> RequestCallback;
+typedef std::function <void (const RequestCallback &callback)> RequestStep;
+typedef std::function <bool (quint32 id)> RequestFilter;
+
 enum class RequestType
 {
     Data,
+    Binding,
     Leave,
     LQI,
     Interview
 };
 
+enum class RequestPriority
+{
+    Action,
+    Response,
+    OTA,
+    Interview,
+    Configuration,
+    Poll,
+    Neighbors
+};
+
 enum class RequestStatus
 {
     Pending,
@@ -49,8 +90,15 @@ public:
     inline quint8 endpointId(void) { return m_endpointId; }
     inline quint16 clusterId(void) { return m_clusterId; }
     inline QByteArray data(void) { return m_data; }
+    inline void setData(const QByteArray &value) { m_data = value; }
+    inline quint8 transactionId(void) { return static_cast <quint8> (m_data.at(m_data.at(0) & FC_MANUFACTURER_SPECIFIC ? 3 : 1)); }
+    inline void setTransactionId(quint8 value) { m_data[m_data.at(0) & FC_MANUFACTURER_SPECIFIC ? 3 : 1] = static_cast <char> (value); }
+    inline quint8 commandId(void) { return static_cast <quint8> (m_data.at(m_data.at(0) & FC_MANUFACTURER_SPECIFIC ? 4 : 2)); }
+    inline bool reply(void) { return !(m_data.at(0) & FC_SERVER_TO_CLIENT) && (m_data.at(0) & FC_CLUSTER_SPECIFIC ? !(m_data.at(0) & FC_DISABLE_DEFAULT_RESPONSE) : commandId() != CMD_DEFAULT_RESPONSE); }
+    inline bool idempotent(void) { return !(m_data.at(0) & (FC_CLUSTER_SPECIFIC | FC_SERVER_TO_CLIENT)) && (commandId() == CMD_READ_ATTRIBUTES || commandId() == CMD_WRITE_ATTRIBUTES || commandId() == CMD_CONFIGURE_REPORTING); }
 
     inline QString name(void) { return m_name; }
+    inline void setName(const QString &value) { m_name = value; }
     inline bool debug(void) { return m_debug; }
 
     inline quint16 manufacturerCode(void) { return m_manufacturerCode; }
@@ -71,25 +119,100 @@ private:
 
 };
 
+class BindingRequestObject
+{
+
+public:
+
+    BindingRequestObject(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address, quint8 dstEndpointId, bool unbind, const QString &name) :
+        m_endpoint(endpoint), m_clusterId(clusterId), m_address(address), m_dstEndpointId(dstEndpointId), m_unbind(unbind), m_name(name) {}
+
+    inline Endpoint endpoint(void) { return m_endpoint; }
+    inline quint16 clusterId(void) { return m_clusterId; }
+    inline QByteArray address(void) { return m_address; }
+    inline quint8 dstEndpointId(void) { return m_dstEndpointId; }
+    inline bool unbind(void) { return m_unbind; }
+    inline QString name(void) { return m_name; }
+
+private:
+
+    Endpoint m_endpoint;
+    quint16 m_clusterId;
+    QByteArray m_address;
+    quint8 m_dstEndpointId;
+    bool m_unbind;
+    QString m_name;
+
+};
+
 class RequestObject
 {
 
 public:
 
-    RequestObject(const QVariant &data, RequestType type) :
-        m_data(data), m_type(type), m_status(RequestStatus::Pending) {}
+    RequestObject(const QVariant &data, RequestType type, RequestPriority priority, const RequestCallback &callback = RequestCallback(), bool response = false) :
+        m_data(data), m_type(type), m_priority(priority), m_status(RequestStatus::Pending), m_tag(0), m_deadline(0), m_retries(0), m_throttled(false), m_callback(callback), m_response(response) {}
 
     inline QVariant data(void) { return m_data; }
     inline RequestType type(void) { return m_type; }
+    inline RequestPriority priority(void) { return m_priority; }
 
     inline RequestStatus status(void) { return m_status; }
     inline void setStatus(RequestStatus value) { m_status = value; }
 
+    inline quint8 tag(void) { return m_tag; }
+    inline void setTag(quint8 value) { m_tag = value; }
+
+    inline qint64 deadline(void) { return m_deadline; }
+    inline void setDeadline(qint64 value) { m_deadline = value; }
+
+    inline int retries(void) { return m_retries; }
+    inline void setRetries(int value) { m_retries = value; }
+
+    inline bool throttled(void) { return m_throttled; }
+    inline void setThrottled(bool value) { m_throttled = value; }
+
+    inline RequestCallback callback(void) { return m_callback; }
+    inline bool response(void) { return m_response; }
+
 private:
 
     QVariant m_data;
     RequestType m_type;
+    RequestPriority m_priority;
     RequestStatus m_status;
+    quint8 m_tag;
+
+    qint64 m_deadline;
+    int m_retries;
+    bool m_throttled;
+
+    RequestCallback m_callback;
+    bool m_response;
+
+};
+
+class RequestQueue
+{
+
+public:
+
+    RequestQueue(int limit = 0) : m_limit(limit), m_active(0) {}
+
+    inline bool isEmpty(void) { return m_devices.isEmpty(); }
+    inline bool ready(void) { return !m_devices.isEmpty() && (!m_limit || m_active < m_limit); }
+    inline void release(void) { m_active--; }
+
+    void enqueue(const QByteArray &ieeeAddress, quint32 id);
+    bool dequeue(quint32 &id, const RequestFilter &filter = RequestFilter());
+    void remove(const QByteArray &ieeeAddress);
+
+private:
+
+    int m_limit, m_active;
+
+    QQueue <QByteArray> m_devices;
+    QMap <QByteArray, QQueue <quint32>> m_requests;
 
 };
 
@@ -118,7 +241,8 @@ public:
         otaUpgradeError,
         clusterRequest,
         globalRequest,
-        requestFinished
+        requestFinished,
+        requestFailed
     };
 
     Q_ENUM(Event)
@@ -151,45 +275,92 @@ public:
 private:
 
     QSettings *m_config;
-    QTimer *m_requestTimer, *m_neignborsTimer, *m_pingTimer, *m_statusLedTimer;
+    QTimer *m_requestTimer, *m_timeoutTimer, *m_neignborsTimer, *m_pingTimer, *m_statusLedTimer;
 
+    QThread *m_adapterThread;
     Adapter *m_adapter;
     DeviceList *m_devices;
 
     QMetaEnum m_events;
-    quint8 m_requestId, m_requestStatus, m_replyId, m_interPanChannel;
-    bool m_replyReceived, m_groupRequestFinished, m_groupsUpdated, m_interPanLock;
+    QByteArray m_ieeeAddress;
+    int m_requestRetries, m_requestBackoff, m_requestRate, m_requestBurst;
+    quint32 m_requestId, m_configurationId;
+    quint8 m_adapterTag, m_interPanChannel;
+    bool m_interPanLock;
 
     QString m_statusLedPin, m_blinkLedPin;
     bool m_debounce, m_discovery, m_cloud, m_debug;
 
-    QMap <quint8, Request> m_requests;
-
-    void enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, const QString &name = QString(), bool debug = false, quint16 manufacturerCode = 0, const Action &action = Action());
-    void enqueueRequest(const Device &device, RequestType type);
+    QMap <quint32, Request> m_requests;
+    QMap <RequestPriority, RequestQueue> m_queues;
+    QMap <quint8, quint32> m_tags;
+    QSet <quint8> m_reservedTags;
+    QMap <QPair <QByteArray, quint8>, quint32> m_transactions;
+    QMap <QPair <QByteArray, QString>, quint32> m_actionRequests;
+    QMap <QPair <QByteArray, quint64>, quint32> m_readRequests;
+
+    QMap <QByteArray, quint32> m_configurations;
+    QList <QPair <Device, RequestCallback>> m_configurationQueue;
+
+    QMap <QString, Device> m_fingerprints;
+    QMap <quint8, QPair <QByteArray, quint8>> m_descriptorTags;
+
+    quint32 enqueueRequest(const Device &device, quint8 endpointId, quint16 clusterId, const QByteArray &data, RequestPriority priority, const QString &name = QString(), bool debug = false, quint16 manufacturerCode = 0, const Action &action = Action());
+    quint32 enqueueRequest(const Device &device, RequestType type, RequestPriority priority);
+    quint32 enqueueRequest(const Request &request);
+
+    Device requestDevice(const Request &request);
+    bool holdRequest(const Device &device, quint32 id);
+    Request findRequest(const Device &device, quint8 transactionId);
+    quint8 adapterTag(void);
+    bool reserveTag(quint8 &tag);
+    bool tagAvailable(void);
+    void releaseTag(quint8 tag);
+    bool pendingTransaction(const Request &request);
+    void releaseTransaction(const Request &request);
+    void releasePending(const Request &request);
+    bool requestToken(const Device &device, qint64 time);
+    void abortRequests(const Device &device);
+
+    void readAttributes(const Device &device, quint8 endpointId, quint16 clusterId, quint16 manufacturerCode, const QList <quint16> &attributes, RequestPriority priority, const QString &name = QString());
+    void adapterRequest(quint8 id, const Device &device, const std::function <bool (void)> &request);
+    bool adapterCall(const std::function <bool (void)> &call);
+
+    void requestCallback(const Request &request, bool success);
+    void requestTimeout(const Request &request);
+    bool idempotentRequest(const Request &request);
+    void retryRequest(quint32 id, const Request &request);
+    void runSteps(QList <RequestStep> steps, const RequestCallback &callback);
 
     bool interviewRequest(quint8 id, const Device &device);
-    bool interviewQuirks(const Device &device);
+    void interviewQuirks(const Device &device, QList <RequestStep> &steps);
     void interviewDevice(const Device &device);
+    bool pendingDescriptors(const Device &device);
     void interviewFinished(const Device &device);
     void interviewError(const Device &device, const QString &reason);
 
-    bool configureDevice(const Device &device);
-    bool configureReporting(const Endpoint &endpoint, const Reporting &reporting);
-    bool bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address = QByteArray(), quint8 dstEndpointId = 0, bool unbind = false, bool manual = false);
-    bool groupRequest(const Endpoint &endpoint, quint16 groupId, bool removeAll = false, bool remove = false);
-    bool dataRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &data, const QString &name);
+    QString fingerprint(const Device &device, bool node = false);
+    void storeFingerprint(const Device &device);
+    bool restoreFingerprint(const Device &device);
+
+    void configureDevice(const Device &device, const RequestCallback &callback);
+    void configurationFinished(const Device &device, quint32 id);
+    void configureReporting(const Endpoint &endpoint, const Reporting &reporting, const RequestCallback &callback = RequestCallback());
+    void bindRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &address = QByteArray(), quint8 dstEndpointId = 0, bool unbind = false, bool manual = false, const RequestCallback &callback = RequestCallback());
+    void groupRequest(const Endpoint &endpoint, quint16 groupId, bool removeAll = false, bool remove = false, const RequestCallback &callback = RequestCallback());
+    void dataRequest(const Endpoint &endpoint, quint16 clusterId, const QByteArray &data, const QString &name, const RequestCallback &callback = RequestCallback());
 
     bool parseProperty(const Endpoint &endpoint, quint16 clusterId, quint8 transactionId, quint16 itemId, const QByteArray &data, bool command = false);
     void parseAttribute(const Endpoint &endpoint, quint16 clusterId, quint8 transactionId, quint16 attributeId, quint8 dataType, const QByteArray &data);
     void clusterCommandReceived(const Endpoint &endpoint, quint16 clusterId, quint16 manufacturerCode, quint8 transactionId, quint8 commandId, const QByteArray &payload);
     void globalCommandReceived(const Endpoint &endpoint, quint16 clusterId, quint16 manufacturerCode, quint8 transactionId, quint8 commandId, QByteArray payload);
 
-    void touchLinkReset(const QByteArray &ieeeAddress, quint8 channel);
-    void touchLinkScan(void);
+    void touchLinkReset(quint8 tag, const QByteArray &ieeeAddress, quint8 channel);
+    void touchLinkScan(quint8 tag);
 
     void interviewTimeoutHandler(const Device &device);
     void rejoinHandler(const Device &device);
+    void deviceAwake(const Device &device);
     void restoreGroups(const Device &device);
     void storeNeighbors(void);
 
@@ -199,7 +370,7 @@ private:
 private slots:
 
     void adapterReset(void);
-    void coordinatorReady(void);
+    void coordinatorReady(const QByteArray &ieeeAddress, const QString &manufacturerName, const QString &modelName, const QString &firmware);
     void permitJoinUpdated(bool enabled);
 
     void deviceJoined(const QByteArray &ieeeAddress, quint16 networkAddress);
@@ -208,8 +379,10 @@ private slots:
     void zclMessageReveived(quint16 networkAddress, quint8 endpointId, quint16 clusterId, quint8 linkQuality, const QByteArray &payload);
     void rawMessageReveived(const QByteArray &ieeeAddress, quint16 clusterId, quint8 linkQuality, const QByteArray &data);
     void requestFinished(quint8 id, quint8 status);
+    void descriptorFailed(quint8 id, quint8 status);
 
     void handleRequests(void);
+    void expireRequests(void);
     void updateNeighbors(void);
     void pingDevices(void);
     void interviewTimeout(void);
@@ -225,11 +398,10 @@ signals:
     void deviceEvent(DeviceObject *device, ZigBee::Event event, const QJsonObject &json = QJsonObject());
     void endpointUpdated(DeviceObject *device, quint8 endpointId);
     void statusUpdated(const QJsonObject &json);
-    void replyReceived(void);
-    void groupRequestFinished(void);
 
 };
 
 Q_DECLARE_METATYPE(DataRequest)
+Q_DECLARE_METATYPE(BindingRequest)
 
 #endif
@@ -1,4 +1,5 @@
 #include <QtEndian>
+#include <QDateTime>
 #include <QThread>
 #include "logger.h"
 #include "zstack.h"
@@ -14,6 +15,7 @@ ZStack::ZStack(QSettings *config, QObject *parent) : Adapter(config, parent), m_
     m_nvItems.insert(ZCD_NV_LOGICAL_TYPE,      QByteArray(1, 0x00));
     m_nvItems.insert(ZCD_NV_ZDO_DIRECT_CB,     QByteArray(1, 0x01));
 
+    m_pipelineDepth = static_cast <quint8> (qBound(0, config->value("zigbee/pipeline", 0).toInt(), ZSTACK_MAX_PIPELINE));
     m_zdoClusters = {ZDO_NODE_DESCRIPTOR_REQUEST, ZDO_SIMPLE_DESCRIPTOR_REQUEST, ZDO_ACTIVE_ENDPOINTS_REQUEST, ZDO_BIND_REQUEST, ZDO_UNBIND_REQUEST, ZDO_LQI_REQUEST, ZDO_LEAVE_REQUEST};
 }
 
@@ -30,7 +32,7 @@ bool ZStack::unicastRequest(quint8 id, quint16 networkAddress, quint8 srcEndPoin
     request.radius = ZSTACK_AF_DEFAULT_RADIUS;
     request.length = static_cast <quint8> (payload.length());
 
-    return sendRequest(ZSTACK_AF_DATA_REQUEST, QByteArray(reinterpret_cast <char*> (&request), sizeof(request)).append(payload)) && !m_replyStatus;
+    return dataRequest(ZSTACK_AF_DATA_REQUEST, id, QByteArray(reinterpret_cast <char*> (&request), sizeof(request)).append(payload));
 }
 
 bool ZStack::multicastRequest(quint8 id, quint16 groupId, quint8 srcEndPointId, quint8 dstEndPointId, quint16 clusterId, const QByteArray &payload)
@@ -93,6 +95,9 @@ bool ZStack::extendedRequest(quint8 id, const QByteArray &address, quint8 dstEnd
     data.radius = dstPanId ? ZSTACK_AF_DEFAULT_RADIUS * 2 : ZSTACK_AF_DEFAULT_RADIUS;
     data.length = qToLittleEndian <quint16> (payload.length());
 
+    if (group)
+        return dataRequest(ZSTACK_AF_DATA_REQUEST_EXT, id, QByteArray(reinterpret_cast <char*> (&data), sizeof(data)).append(payload));
+
     return sendRequest(ZSTACK_AF_DATA_REQUEST_EXT, QByteArray(reinterpret_cast <char*> (&data), sizeof(data)).append(payload)) && !m_replyStatus;
 }
 
@@ -102,26 +107,73 @@ bool ZStack::extendedRequest(quint8 id, quint16 address, quint8 dstEndpointId, q
     return extendedRequest(id, QByteArray(reinterpret_cast <char*> (&address), sizeof(address)), dstEndpointId, dstPanId, srcEndpointId, clusterId, paylaod, group);
 }
 
-bool ZStack::sendRequest(quint16 command, const QByteArray &data)
+bool ZStack::dataRequest(quint16 command, quint8 id, const QByteArray &data)
+{
+    qint64 time = QDateTime::currentMSecsSinceEpoch();
+
+    if (!m_pipelineDepth)
+        return sendRequest(command, data) && !m_replyStatus;
+
+    for (auto it = m_pipeline.begin(); it != m_pipeline.end(); )
+    {
+        if (it.value() + ZSTACK_CONFIRM_TIMEOUT > time)
+        {
+            it++;
+            continue;
+        }
+
+        logWarning << "Data request" << QString::asprintf("0x%02x", it.key()) << "confirm timed out";
+        m_pipelineReplies.removeAll(it.key());
+        it = m_pipeline.erase(it);
+    }
+
+    if (m_pipeline.count() >= m_pipelineDepth && !waitForSignal(this, SIGNAL(pipelineReleased()), ZSTACK_REQUEST_TIMEOUT))
+    {
+        m_replyStatus = 0xFF;
+        return false;
+    }
+
+    m_pipeline.insert(id, time);
+    m_pipelineReplies.enqueue(id);
+
+    writeRequest(command, data);
+    return true;
+}
+
+void ZStack::writeRequest(quint16 command, const QByteArray &data)
 {
     QByteArray request;
+    quint16 value = qToBigEndian(command);
     quint8 fcs = 0;
 
     logDebug(m_adapterDebug) << "-->" << QString::asprintf("0x%04x", command) << data.toHex(':');
 
-    m_command = qToBigEndian(command);
-    m_replyStatus = 0xFF;
-
     request.append(ZSTACK_PACKET_FLAG);
     request.append(static_cast <char> (data.length()));
-    request.append(reinterpret_cast <char*> (&m_command), sizeof(m_command));
+    request.append(reinterpret_cast <char*> (&value), sizeof(value));
     request.append(data);
 
     for (int i = 1; i < request.length(); i++)
         fcs ^= request[i];
 
     sendData(request.append(static_cast <char> (fcs)));
-    return waitForSignal(this, SIGNAL(dataReceived()), ZSTACK_REQUEST_TIMEOUT);
+}
+
+bool ZStack::sendRequest(quint16 command, const QByteArray &data)
+{
+    m_command = qToBigEndian(command);
+    m_replyStatus = 0xFF;
+
+    if (m_pipelineDepth && (command == ZSTACK_AF_DATA_REQUEST || command == ZSTACK_AF_DATA_REQUEST_EXT))
+        m_pipelineReplies.enqueue(ZSTACK_SYNCHRONOUS_REPLY);
+
+    writeRequest(command, data);
+
+    if (waitForSignal(this, SIGNAL(dataReceived()), ZSTACK_REQUEST_TIMEOUT))
+        return true;
+
+    m_pipelineReplies.removeOne(ZSTACK_SYNCHRONOUS_REPLY);
+    return false;
 }
 
 void ZStack::parsePacket(quint16 command, const QByteArray &data)
@@ -130,8 +182,22 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
 
     if (command & 0x2000)
     {
+        if (((command ^ 0x4000) == ZSTACK_AF_DATA_REQUEST || (command ^ 0x4000) == ZSTACK_AF_DATA_REQUEST_EXT) && !m_pipelineReplies.isEmpty() && m_pipelineReplies.head() != ZSTACK_SYNCHRONOUS_REPLY)
+        {
+            quint8 id = static_cast <quint8> (m_pipelineReplies.dequeue()), status = static_cast <quint8> (data.at(0));
+
+            if (status && m_pipeline.remove(id))
+            {
+                emit requestFinished(id, status);
+                emit pipelineReleased();
+            }
+
+            return;
+        }
+
         if ((command ^ 0x4000) == qFromBigEndian(m_command))
         {
+            m_pipelineReplies.removeOne(ZSTACK_SYNCHRONOUS_REPLY);
             m_replyStatus = static_cast <quint8> (data.at(0));
             m_replyData = data;
             emit dataReceived();
@@ -152,6 +218,9 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
 
         case ZSTACK_SYS_RESET_IND:
         {
+            m_pipeline.clear();
+            m_pipelineReplies.clear();
+
             if (!startCoordinator())
             {
                 logWarning << "Coordinator startup failed";
@@ -165,6 +234,10 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
         case ZSTACK_AF_DATA_CONFIRM:
         {
             const zstackDataConfirmStruct *message = reinterpret_cast <const zstackDataConfirmStruct*> (data.constData());
+
+            if (m_pipeline.remove(message->transactionId))
+                emit pipelineReleased();
+
             emit requestFinished(message->transactionId, message->status);
             break;
         }
@@ -197,7 +270,7 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
                 m_status = static_cast <quint8> (data.at(0));
 
             if (m_version == ZStackVersion::ZStack12x && m_status == ZSTACK_COORDINATOR_STARTED)
-                emit coordinatorReady();
+                emit coordinatorReady(m_ieeeAddress, m_manufacturerName, m_modelName, m_firmware);
 
             break;
         }
@@ -235,7 +308,7 @@ void ZStack::parsePacket(quint16 command, const QByteArray &data)
             switch (m_status)
             {
                 case ZSTACK_NOT_STARTED_AUTOMATICALLY: logWarning << "Network not started, PAN ID collision detected"; break;
-                case ZSTACK_COORDINATOR_STARTED: emit coordinatorReady(); break;
+                case ZSTACK_COORDINATOR_STARTED: emit coordinatorReady(m_ieeeAddress, m_manufacturerName, m_modelName, m_firmware); break;
             };
 
             break;
@@ -514,41 +587,47 @@ void ZStack::softReset(void)
     sendRequest(ZSTACK_SYS_RESET_REQ, QByteArray(1, 0x01));
 }
 
-void ZStack::parseData(QByteArray &buffer)
+int ZStack::parseData(const QByteArray &buffer)
 {
-    while (!buffer.isEmpty())
+    int offset = 0;
+
+    while (offset < buffer.length())
     {
+        int index = buffer.indexOf(static_cast <char> (ZSTACK_PACKET_FLAG), offset);
+        const char *frame;
         quint8 length, fcs = 0;
 
-        if (!buffer.at(0))
-            buffer.remove(0, 1);
+        if (index < 0)
+            return buffer.length();
 
-        if (buffer.length() < 5 || buffer.at(0) != static_cast <char> (ZSTACK_PACKET_FLAG))
-        {
-            buffer.clear();
+        offset = index;
+
+        if (buffer.length() - offset < 5)
             break;
-        }
 
-        length = static_cast <quint8> (buffer.at(1));
+        frame = buffer.constData() + offset;
+        length = static_cast <quint8> (frame[1]);
 
-        if (buffer.length() < length + 5)
+        if (buffer.length() - offset < length + 5)
             break;
 
-        logDebug(m_portDebug) << "Frame received:" << buffer.mid(0, length + 5).toHex(':');
+        logDebug(m_portDebug) << "Frame received:" << buffer.mid(offset, length + 5).toHex(':');
 
-        for (quint8 i = 1; i < length + 4; i++)
-            fcs ^= buffer.at(i);
+        for (int i = 1; i < length + 4; i++)
+            fcs ^= frame[i];
 
-        if (fcs != static_cast <quint8> (buffer.at(length + 4)))
+        if (fcs != static_cast <quint8> (frame[length + 4]))
         {
-            logWarning << "Frame" << buffer.mid(0, length + 5).toHex(':') << "FCS mismatch";
-            buffer.clear();
-            break;
+            logWarning << "Frame" << buffer.mid(offset, length + 5).toHex(':') << "FCS mismatch";
+            offset++;
+            continue;
         }
 
-        m_queue.enqueue(buffer.mid(2, length + 2));
-        buffer.remove(0, length + 5);
+        m_queue.enqueue(QByteArray(frame + 2, length + 2));
+        offset += length + 5;
     }
+
+    return offset;
 }
 
 bool ZStack::permitJoin(bool enabled)
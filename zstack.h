@@ -3,6 +3,9 @@
 
 #define ZSTACK_CLEAR_DELAY                      4000
 #define ZSTACK_REQUEST_TIMEOUT                  10000
+#define ZSTACK_CONFIRM_TIMEOUT                  30000
+#define ZSTACK_MAX_PIPELINE                     16
+#define ZSTACK_SYNCHRONOUS_REPLY                -1
 
 #define ZSTACK_SKIP_BOOTLOADER                  0xEF
 #define ZSTACK_PACKET_FLAG                      0xFE
@@ -246,18 +249,24 @@ private:
 
     ZStackVersion m_version;
 
-    quint8 m_status;
+    quint8 m_status, m_pipelineDepth;
     bool m_clear;
 
     quint16 m_command;
     QByteArray m_replyData;
 
+    QMap <quint8, qint64> m_pipeline;
+    QQueue <qint16> m_pipelineReplies;
+
     QMap <quint16, QByteArray> m_nvItems;
     QList <quint16> m_zdoClusters;
 
     bool extendedRequest(quint8 id, const QByteArray &address, quint8 dstEndpointId, quint16 dstPanId, quint8 srcEndpointId, quint16 clusterId, const QByteArray &payload, bool group = false);
     bool extendedRequest(quint8 id, quint16 address, quint8 dstEndpointId, quint16 dstPanId, quint8 srcEndpointId, quint16 clusterId, const QByteArray &paylaod, bool group = false);
 
+    bool dataRequest(quint16 command, quint8 id, const QByteArray &data);
+
+    void writeRequest(quint16 command, const QByteArray &data);
     bool sendRequest(quint16 command, const QByteArray &data = QByteArray());
     void parsePacket(quint16 command, const QByteArray &data);
 
@@ -266,7 +275,7 @@ private:
     bool startCoordinator(void);
 
     void softReset(void) override;
-    void parseData(QByteArray &buffer) override;
+    int parseData(const QByteArray &buffer) override;
     bool permitJoin(bool enabled) override;
 
 private slots:
@@ -276,6 +285,7 @@ private slots:
 signals:
 
     void dataReceived(void);
+    void pipelineReleased(void);
 
 };
 